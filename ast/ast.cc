@@ -2,8 +2,9 @@
 
 namespace cbc {
 
-AST::AST(const Location& source, Declarations* declarations) :
-    source_(source), decls_(declarations)
+AST::AST(const Location& source, Declarations* declarations,
+        ConstantTable* constants) :
+    Node(kAST), source_(source), decls_(declarations), constants_(constants)
 {
     decls_->inc_ref();
 }
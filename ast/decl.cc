@@ -6,6 +6,7 @@ namespace cbc {
 
 void Declarations::add(Declarations* decls)
 {
+    check_sealed();
     for_each(decls->defvars_.begin(), decls->defvars_.end(), [this](DefinedVariable* v) {
         if (defvars_.count(v))
             return;
@@ -63,6 +64,10 @@ void Declarations::add(Declarations* decls)
     });
 }
 
+Declarations::Declarations() : sealed_(false)
+{
+}
+
 Declarations::~Declarations()
 {
     for_each(defvars_.begin(), defvars_.end(), [this](DefinedVariable* v) { v->dec_ref(); });
@@ -77,6 +82,7 @@ Declarations::~Declarations()
 
 void Declarations::add_defvar(DefinedVariable* var)
 {
+    check_sealed();
     if (!defvars_.count(var)) {
         var->inc_ref();
         defvars_.insert(var);
@@ -85,6 +91,7 @@ void Declarations::add_defvar(DefinedVariable* var)
     
 void Declarations::add_defvars(vector<DefinedVariable*>&& vars)
 {
+    check_sealed();
     for_each(vars.begin(), vars.end(), [this](DefinedVariable* v) {
         if (defvars_.count(v))
             return;
@@ -92,6 +99,8 @@ void Declarations::add_defvars(vector<DefinedVariable*>&& vars)
         // XXX: move constructor don't increase ref!!
         defvars_.insert(v);
     });
+    // the references are ours now
+    vars.clear();
 }
 
 vector<DefinedVariable*> Declarations::defvars()
@@ -103,6 +112,7 @@ vector<DefinedVariable*> Declarations::defvars()
 
 void Declarations::add_declvar(UndefinedVariable* var)
 {
+    check_sealed();
     if (!declvars_.count(var)) {
         var->inc_ref();
         declvars_.insert(var);
@@ -118,6 +128,7 @@ vector<UndefinedVariable*> Declarations::declvars()
 
 void Declarations::add_constant(Constant* c)
 {
+    check_sealed();
     if (!constants_.count(c)) {
         c->inc_ref();
         constants_.insert(c);
@@ -133,6 +144,7 @@ vector<Constant*> Declarations::constants()
 
 void Declarations::add_deffunc(DefinedFunction* func)
 {
+    check_sealed();
     if (!defuncs_.count(func)) {
         func->inc_ref();
         defuncs_.insert(func);
@@ -148,6 +160,7 @@ vector<DefinedFunction*> Declarations::deffuncs()
 
 void Declarations::add_declfunc(UndefinedFunction* func)
 {
+    check_sealed();
     if (!declfuncs_.count(func)) {
         func->inc_ref();
         declfuncs_.insert(func);
@@ -163,6 +176,7 @@ vector<UndefinedFunction*> Declarations::declfuncs()
 
 void Declarations::add_defstruct(StructNode* n)
 {
+    check_sealed();
     if (!defstructs_.count(n)) {
         n->inc_ref();
         defstructs_.insert(n);
@@ -178,6 +192,7 @@ vector<StructNode*> Declarations::defstructs()
 
 void Declarations::add_defunion(UnionNode* n)
 {
+    check_sealed();
     if (!defunions_.count(n)) {
         n->inc_ref();
         defunions_.insert(n);
@@ -193,6 +208,7 @@ vector<UnionNode*> Declarations::defunions()
 
 void Declarations::add_typedef(TypedefNode* n)
 {
+    check_sealed();
     if (!typedefs_.count(n)) {
         n->inc_ref();
         typedefs_.insert(n);
@@ -206,4 +222,11 @@ vector<TypedefNode*> Declarations::typedefs()
     return v;
 }
 
+void Declarations::check_sealed()
+{
+    if (sealed_) {
+        throw string("must not happen: modifying sealed declarations");
+    }
+}
+
 } // namespace cbc
\ No newline at end of file
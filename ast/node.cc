@@ -15,19 +15,19 @@ void Node::dump(Dumper& dumper)
 }
 
 TypeNode::TypeNode(Type* tp) : 
-    type_(tp), ref_(nullptr)
+    Node(kTypeNode), type_(tp), ref_(nullptr)
 {
     type_->inc_ref();
 }
 
 TypeNode::TypeNode(TypeRef* ref) : 
-    type_(nullptr), ref_(ref)
+    Node(kTypeNode), type_(nullptr), ref_(ref)
 {
     ref_->inc_ref();
 }
 
 TypeNode::TypeNode(Type* tp, TypeRef* ref) : 
-    type_(tp), ref_(ref)
+    Node(kTypeNode), type_(tp), ref_(ref)
 {
     type_->inc_ref();
     ref_->inc_ref();
@@ -81,8 +81,8 @@ bool ExprNode::is_pointer()
     }
 }
 
-LiteralNode::LiteralNode(const Location& loc, TypeRef* ref) : 
-    loc_(loc), tnode_(new TypeNode(ref))
+LiteralNode::LiteralNode(Kind kind, const Location& loc, TypeRef* ref) : 
+    ExprNode(kind), loc_(loc), tnode_(new TypeNode(ref))
 {
 }
     
@@ -92,7 +92,7 @@ LiteralNode::~LiteralNode()
 }
 
 IntegerLiteralNode::IntegerLiteralNode(const Location& loc, TypeRef* ref, long value) : 
-    LiteralNode(loc, ref), value_(value)
+    LiteralNode(kIntegerLiteral, loc, ref), value_(value)
 {
 }
 
@@ -103,17 +103,24 @@ void IntegerLiteralNode::dump_node(Dumper& dumper)
 }
 
 StringLiteralNode::StringLiteralNode(const Location& loc, 
-        TypeRef* ref, const string& value) :
-    LiteralNode(loc, ref), value_(value), entry_(nullptr)
+        TypeRef* ref, ConstantEntry* entry) :
+    LiteralNode(kStringLiteral, loc, ref), entry_(entry)
 {
+    entry_->inc_ref();
+}
+
+StringLiteralNode::~StringLiteralNode()
+{
+    entry_->dec_ref();
 }
 
 void StringLiteralNode::dump_node(Dumper& dumper) 
 { 
-    dumper.print_member("value", value_);
+    dumper.print_member("value", value());
 }
 
-LHSNode::LHSNode() : type_(nullptr), orig_type_(nullptr)
+LHSNode::LHSNode(Kind kind) :
+    ExprNode(kind), type_(nullptr), orig_type_(nullptr)
 {
 }
 
@@ -135,8 +142,8 @@ bool LHSNode::is_loadable()
     return !t->is_array() && !t->is_function();
 }
 
-VariableNode::VariableNode(const Location& loc, const string& name) : 
-    loc_(loc), name_(name), entity_(nullptr)
+VariableNode::VariableNode(const Location& loc, Symbol name) : 
+    LHSNode(kVariable), loc_(loc), name_(name), entity_(nullptr)
 {
 }
 
@@ -198,7 +205,12 @@ TypeNode* VariableNode::type_node()
 }
 
 UnaryOpNode::UnaryOpNode(const string& op, ExprNode* node) : 
-    op_(op), expr_(node), op_type_(nullptr)
+    UnaryOpNode(kUnaryOp, op, node)
+{
+}
+
+UnaryOpNode::UnaryOpNode(Kind kind, const string& op, ExprNode* node) : 
+    ExprNode(kind), op_(op), expr_(node), op_type_(nullptr)
 {
     expr_->inc_ref();
 }
@@ -227,18 +239,19 @@ void UnaryOpNode::dump_node(Dumper& dumper)
     dumper.print_member("expr", expr_);
 }
 
-UnaryArithmeticOpNode::UnaryArithmeticOpNode(const string& op, ExprNode* node) : 
-    UnaryOpNode(op, node), amount_(0)
+UnaryArithmeticOpNode::UnaryArithmeticOpNode(Kind kind, const string& op,
+        ExprNode* node) : 
+    UnaryOpNode(kind, op, node), amount_(0)
 {
 }
 
 SuffixOpNode::SuffixOpNode(const string& op, ExprNode* expr) : 
-    UnaryArithmeticOpNode(op, expr)
+    UnaryArithmeticOpNode(kSuffixOp, op, expr)
 {
 }
 
 ArefNode::ArefNode(ExprNode* expr, ExprNode* index) : 
-    expr_(expr), index_(index)
+    LHSNode(kAref), expr_(expr), index_(index)
 {
     expr_->inc_ref();
     index_->inc_ref();
@@ -252,7 +265,7 @@ ArefNode::~ArefNode()
 
 bool ArefNode::is_multi_dimension()
 {
-    ArefNode* expr = dynamic_cast<ArefNode*>(expr_);
+    ArefNode* expr = dyn_cast<ArefNode>(expr_);
     return expr && !expr->orig_type()->is_pointer();
 }
 
@@ -282,13 +295,13 @@ void ArefNode::dump_node(Dumper& dumper)
     dumper.print_member("index", index_);
 }
 
-Slot::Slot() : tnode_(nullptr), offset_(Type::kSizeUnknown)
+Slot::Slot() : Node(kSlot), tnode_(nullptr), offset_(Type::kSizeUnknown)
 {
 }
 
 
-Slot::Slot(TypeNode* t, const string& n) : 
-    tnode_(t), name_(n), offset_(Type::kSizeUnknown)
+Slot::Slot(TypeNode* t, Symbol n) : 
+    Node(kSlot), tnode_(t), name_(n), offset_(Type::kSizeUnknown)
 {
     tnode_->inc_ref();
 }
@@ -304,8 +317,8 @@ void Slot::dump_node(Dumper& dumper)
     dumper.print_member("typeNode", tnode_);
 }
 
-MemberNode::MemberNode(ExprNode* expr, const string& member) :
-    expr_(expr), member_(member)
+MemberNode::MemberNode(ExprNode* expr, Symbol member) :
+    LHSNode(kMember), expr_(expr), member_(member)
 {
     expr_->inc_ref();
 }
@@ -330,8 +343,8 @@ void MemberNode::dump_node(Dumper& dumper)
     dumper.print_member("member", member_);
 }
 
-PtrMemberNode::PtrMemberNode(ExprNode* expr, const string& member) : 
-    expr_(expr), member_(member)
+PtrMemberNode::PtrMemberNode(ExprNode* expr, Symbol member) : 
+    LHSNode(kPtrMember), expr_(expr), member_(member)
 {
     expr_->inc_ref();
 }
@@ -364,7 +377,7 @@ void PtrMemberNode::dump_node(Dumper& dumper)
 }
     
 FuncallNode::FuncallNode(ExprNode* expr, vector<ExprNode*>&& args) :
-    expr_(expr), args_(move(args))
+    ExprNode(kFuncall), expr_(expr), args_(move(args))
 {
     // move constructor don't increase ref
     expr_->inc_ref();
@@ -413,7 +426,7 @@ void FuncallNode::dump_node(Dumper &dumper)
 }
 
 SizeofExprNode::SizeofExprNode(ExprNode* expr, TypeRef* ref) :
-    expr_(expr), tnode_(new TypeNode(ref))
+    ExprNode(kSizeofExpr), expr_(expr), tnode_(new TypeNode(ref))
 {
     expr_->inc_ref();
 }
@@ -437,7 +450,7 @@ void SizeofExprNode::dump_node(Dumper& dumper)
 }
 
 SizeofTypeNode::SizeofTypeNode(TypeNode* operand, TypeRef* ref) :
-    op_(operand), tnode_(new TypeNode(ref))
+    ExprNode(kSizeofType), op_(operand), tnode_(new TypeNode(ref))
 {
     op_->inc_ref();
 }
@@ -453,7 +466,8 @@ void SizeofTypeNode::dump_node(Dumper& dumper)
     dumper.print_member("operand", op_);
 }
 
-AddressNode::AddressNode(ExprNode* expr) : expr_(expr), type_(nullptr)
+AddressNode::AddressNode(ExprNode* expr) :
+    ExprNode(kAddress), expr_(expr), type_(nullptr)
 {
     expr_->inc_ref();
 }
@@ -491,7 +505,7 @@ void AddressNode::dump_node(Dumper& dumper)
 }
 
 DereferenceNode::DereferenceNode(ExprNode* expr)
-    : expr_(expr)
+    : LHSNode(kDereference), expr_(expr)
 {
     expr_->inc_ref();
 }
@@ -523,18 +537,18 @@ void DereferenceNode::dump_node(Dumper& dumper)
 }
 
 PrefixOpNode::PrefixOpNode(const string& op, ExprNode* expr) :
-    UnaryArithmeticOpNode(op, expr)
+    UnaryArithmeticOpNode(kPrefixOp, op, expr)
 {
 }
 
 CastNode::CastNode(Type* t, ExprNode* expr) : 
-    tnode_(new TypeNode(t)), expr_(expr)
+    ExprNode(kCast), tnode_(new TypeNode(t)), expr_(expr)
 {
     expr_->inc_ref();
 }
 
 CastNode::CastNode(TypeNode* t, ExprNode* expr) : 
-    tnode_(t), expr_(expr)
+    ExprNode(kCast), tnode_(t), expr_(expr)
 {
     tnode_->inc_ref();
     expr_->inc_ref();
@@ -553,14 +567,20 @@ CastNode::~CastNode()
 }
 
 BinaryOpNode::BinaryOpNode(ExprNode* left, const string& op, ExprNode* right) : 
-    type_(nullptr), left_(left), op_(op), right_(right)
+    BinaryOpNode(kBinaryOp, left, op, right)
+{
+}
+
+BinaryOpNode::BinaryOpNode(Kind kind, ExprNode* left, const string& op,
+        ExprNode* right) : 
+    ExprNode(kind), type_(nullptr), left_(left), op_(op), right_(right)
 {
     left_->inc_ref();
     right_->inc_ref();
 }
 
 BinaryOpNode::BinaryOpNode(Type* t, ExprNode* left, const string& op, ExprNode* right) : 
-    type_(t), left_(left), op_(op), right_(right)
+    ExprNode(kBinaryOp), type_(t), left_(left), op_(op), right_(right)
 {
     type_->inc_ref();
     left_->inc_ref();
@@ -591,17 +611,17 @@ void BinaryOpNode::dump_node(Dumper& dumper)
 }
 
 LogicalAndNode::LogicalAndNode(ExprNode* left, ExprNode* right) : 
-    BinaryOpNode(left, "&&", right)
+    BinaryOpNode(kLogicalAnd, left, "&&", right)
 {
 }
 
 LogicalOrNode::LogicalOrNode(ExprNode* left, ExprNode* right) : 
-    BinaryOpNode(left, "&&", right)
+    BinaryOpNode(kLogicalOr, left, "&&", right)
 {
 }
 
 CondExprNode::CondExprNode(ExprNode* c, ExprNode* t, ExprNode* e) :
-    cond_(c), then_expr_(t), else_expr_(e)
+    ExprNode(kCondExpr), cond_(c), then_expr_(t), else_expr_(e)
 {
     cond_->inc_ref();
     then_expr_->inc_ref();
@@ -636,8 +656,9 @@ void CondExprNode::dump_node(Dumper& dumper)
     dumper.print_member("else_expr", else_expr_);
 }
 
-AbstractAssignNode::AbstractAssignNode(ExprNode* lhs, ExprNode* rhs) : 
-    lhs_(lhs), rhs_(rhs)
+AbstractAssignNode::AbstractAssignNode(Kind kind, ExprNode* lhs,
+        ExprNode* rhs) : 
+    ExprNode(kind), lhs_(lhs), rhs_(rhs)
 {
     lhs_->inc_ref();
     rhs_->inc_ref();
@@ -663,29 +684,30 @@ AbstractAssignNode::~AbstractAssignNode()
 }
 
 AssignNode::AssignNode(ExprNode* lhs, ExprNode* rhs) :
-    AbstractAssignNode(lhs, rhs)
+    AbstractAssignNode(kAssign, lhs, rhs)
 {
 }
 
 OpAssignNode::OpAssignNode(ExprNode* lhs, const string& op, ExprNode* rhs) :
-    AbstractAssignNode(lhs, rhs), op_(op)
+    AbstractAssignNode(kOpAssign, lhs, rhs), op_(op)
 {
 }
 
-StmtNode::StmtNode(const Location& loc) : loc_(loc)
+StmtNode::StmtNode(Kind kind, const Location& loc) :
+    Node(kind), loc_(loc)
 {   
 }
 
-BreakNode::BreakNode(const Location& loc) : StmtNode(loc)
+BreakNode::BreakNode(const Location& loc) : StmtNode(kBreak, loc)
 {
 }
 
-ContinueNode::ContinueNode(const Location& loc) : StmtNode(loc)
+ContinueNode::ContinueNode(const Location& loc) : StmtNode(kContinue, loc)
 {
 }
 
 ReturnNode::ReturnNode(const Location& loc, ExprNode* expr) : 
-    StmtNode(loc), expr_(expr)
+    StmtNode(kReturn, loc), expr_(expr)
 {
     expr_->inc_ref();
 }
@@ -707,8 +729,8 @@ void ReturnNode::dump_node(Dumper& dumper)
     dumper.print_member("expr", expr_);
 }
 
-GotoNode::GotoNode(const Location& loc, const string& target) :
-    StmtNode(loc), target_(target)
+GotoNode::GotoNode(const Location& loc, Symbol target) :
+    StmtNode(kGoto, loc), target_(target)
 {
 }
 
@@ -719,7 +741,7 @@ void GotoNode::dump_node(Dumper& dumper)
 
 BlockNode::BlockNode(const Location& loc, vector<DefinedVariable*>&& vars,
         vector<StmtNode*>&& stmts) :
-    StmtNode(loc), vars_(move(vars)), stmts_(move(stmts))
+    StmtNode(kBlock, loc), vars_(move(vars)), stmts_(move(stmts))
 {
     for (auto* d : vars_) {
         // d->inc_ref();
@@ -756,7 +778,7 @@ void BlockNode::dump_node(Dumper& dumper)
 }
 
 ExprStmtNode::ExprStmtNode(const Location& loc, ExprNode* expr)
-    : StmtNode(loc), expr_(expr)
+    : StmtNode(kExprStmt, loc), expr_(expr)
 {
     expr_->inc_ref();
 }
@@ -778,8 +800,8 @@ void ExprStmtNode::dump_node(Dumper& dumper)
     dumper.print_member("expr", expr_);
 }
 
-LabelNode::LabelNode(const Location& loc, const string& name, StmtNode* stmt) : 
-    StmtNode(loc), name_(name), stmt_(stmt)
+LabelNode::LabelNode(const Location& loc, Symbol name, StmtNode* stmt) : 
+    StmtNode(kLabel, loc), name_(name), stmt_(stmt)
 {
     stmt_->inc_ref();
 }
@@ -797,7 +819,7 @@ void LabelNode::dump_node(Dumper& dumper)
 
 CaseNode::CaseNode(const Location& loc, vector<ExprNode*>&& values, 
         BlockNode* body) : 
-    StmtNode(loc), values_(move(values)), body_(body)
+    StmtNode(kCase, loc), values_(move(values)), body_(body)
 {
     for (auto* e : values_) {
         // e->inc_ref();
@@ -821,7 +843,7 @@ void CaseNode::dump_node(Dumper& dumper)
     
 SwitchNode::SwitchNode(const Location& loc, ExprNode* cond, 
         vector<CaseNode*>&& cases) :
-    StmtNode(loc), cond_(cond), cases_(move(cases))
+    StmtNode(kSwitch, loc), cond_(cond), cases_(move(cases))
 {
     cond_->inc_ref();
     for (auto* e : cases_) {
@@ -845,8 +867,9 @@ void SwitchNode::dump_node(Dumper& dumper)
 
 ForNode::ForNode(const Location& loc, ExprNode* init, 
         ExprNode* cond, ExprNode* incr, StmtNode* body) : 
-    StmtNode(loc), body_(body)
+    StmtNode(kFor, loc), body_(body)
 {
+    body_->inc_ref();
     if (init) {
         init_ = new ExprStmtNode(init->location(), init);
     } else {
@@ -875,6 +898,7 @@ ForNode::~ForNode()
     init_->dec_ref();
     cond_->dec_ref();
     incr_->dec_ref();
+    body_->dec_ref();
 }
 
 void ForNode::dump_node(Dumper& dumper)
@@ -886,7 +910,7 @@ void ForNode::dump_node(Dumper& dumper)
 }
 
 DoWhileNode::DoWhileNode(const Location& loc, StmtNode* body, ExprNode* cond) : 
-    StmtNode(loc), body_(body), cond_(cond)
+    StmtNode(kDoWhile, loc), body_(body), cond_(cond)
 {
     body_->inc_ref();
     cond_->inc_ref();
@@ -905,7 +929,7 @@ void DoWhileNode::dump_node(Dumper& dumper)
 }
 
 WhileNode::WhileNode(const Location& loc, ExprNode* cond, StmtNode* body) : 
-    StmtNode(loc), cond_(cond), body_(body)
+    StmtNode(kWhile, loc), cond_(cond), body_(body)
 {
     cond_->inc_ref();
     body_->inc_ref();
@@ -925,7 +949,7 @@ void WhileNode::dump_node(Dumper& dumper)
 
 IfNode::IfNode(const Location& loc, ExprNode* c, 
         StmtNode* t, StmtNode* e) : 
-    StmtNode(loc), cond_(c), then_body_(t), else_body_(e)
+    StmtNode(kIf, loc), cond_(c), then_body_(t), else_body_(e)
 {
     cond_->inc_ref();
     then_body_->inc_ref();
@@ -946,8 +970,9 @@ void IfNode::dump_node(Dumper& dumper)
     dumper.print_member("else_body", else_body_);
 }
 
-TypeDefinition::TypeDefinition(const Location& loc, TypeRef* ref, const string& name) :
-    loc_(loc), tnode_(new TypeNode(ref)), name_(name)
+TypeDefinition::TypeDefinition(Kind kind, const Location& loc, TypeRef* ref,
+        Symbol name) :
+    Node(kind), loc_(loc), tnode_(new TypeNode(ref)), name_(name)
 {
     // don't need to increase tnode_
     // don't need to decrease ref
@@ -960,9 +985,9 @@ TypeDefinition::~TypeDefinition()
     tnode_->dec_ref();
 }
 
-CompositeTypeDefinition::CompositeTypeDefinition(const Location &loc, TypeRef* ref,
-        const string& name, vector<Slot*>&& membs) :
-    TypeDefinition(loc, ref, name), members_(move(membs))
+CompositeTypeDefinition::CompositeTypeDefinition(Kind kind, const Location &loc,
+        TypeRef* ref, Symbol name, vector<Slot*>&& membs) :
+    TypeDefinition(kind, loc, ref, name), members_(move(membs))
 {
     for (auto* s : members_) {
         // s->inc_ref();
@@ -983,8 +1008,8 @@ void CompositeTypeDefinition::dump_node(Dumper& dumper)
 }
 
 StructNode::StructNode(const Location &loc, TypeRef* ref,
-        const string& name, vector<Slot*>&& membs):
-    CompositeTypeDefinition(loc, ref, name, move(membs))
+        Symbol name, vector<Slot*>&& membs):
+    CompositeTypeDefinition(kStruct, loc, ref, name, move(membs))
 {
 }
 
@@ -994,8 +1019,8 @@ Type* StructNode::defining_type()
 }
 
 UnionNode::UnionNode(const Location &loc, TypeRef* ref,
-        const string& name, vector<Slot*>&& membs):
-    CompositeTypeDefinition(loc, ref, name, move(membs))
+        Symbol name, vector<Slot*>&& membs):
+    CompositeTypeDefinition(kUnion, loc, ref, name, move(membs))
 {
 }
 
@@ -1004,8 +1029,8 @@ Type* UnionNode::defining_type()
     return new UnionType(name(), members(), location());
 }
 
-TypedefNode::TypedefNode(const Location& loc, TypeRef* real, const string& name) :
-    TypeDefinition(loc, new UserTypeRef(name), name), 
+TypedefNode::TypedefNode(const Location& loc, TypeRef* real, Symbol name) :
+    TypeDefinition(kTypedef, loc, new UserTypeRef(name), name), 
     real_(new TypeNode(real))
 {
     // don't need to real
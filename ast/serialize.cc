@@ -0,0 +1,677 @@
+#include "serialize.h"
+
+#include <cstring>
+#include <map>
+
+#include "ref_ptr.h"
+
+namespace cbc {
+
+enum TypeRefTag {
+    kVoidRef = 1,
+    kIntegerRef,
+    kPointerRef,
+    kArrayRef,
+    kFunctionRef,
+    kStructRef,
+    kUnionRef,
+    kUserRef,
+};
+
+enum ExprTag {
+    kIntegerLiteral = 1,
+    kStringLiteral,
+    kVariable,
+    kUnaryOp,
+    kPrefixOp,
+    kSuffixOp,
+    kBinaryOp,
+    kLogicalAnd,
+    kLogicalOr,
+    kCondExpr,
+    kCast,
+    kSizeofType,
+    kSizeofExpr,
+    kAddress,
+    kDereference,
+    kAref,
+    kMember,
+    kPtrMember,
+    kFuncall,
+};
+
+void DeclWriter::write_u8(uint8_t v)
+{
+    out_.push_back((char)v);
+}
+
+void DeclWriter::write_u32(uint32_t v)
+{
+    out_.append((const char*)&v, sizeof(v));
+}
+
+void DeclWriter::write_u64(uint64_t v)
+{
+    out_.append((const char*)&v, sizeof(v));
+}
+
+void DeclWriter::write_string(const string& s)
+{
+    write_u32(s.size());
+    out_.append(s);
+}
+
+void DeclWriter::write_location(Location loc)
+{
+    // a header only has locations in itself, or made up ones
+    write_u8(loc.file() != 0);
+    write_u32(loc.offset());
+}
+
+void DeclWriter::write_typeref(TypeRef* ref)
+{
+    switch (ref->kind()) {
+    case TypeRef::kVoid:
+        write_u8(kVoidRef);
+        write_location(ref->location());
+        break;
+
+    case TypeRef::kInteger:
+        write_u8(kIntegerRef);
+        write_string(cast<IntegerTypeRef>(ref)->name());
+        write_location(ref->location());
+        break;
+
+    case TypeRef::kPointer:
+        write_u8(kPointerRef);
+        write_typeref(cast<PointerTypeRef>(ref)->base_type());
+        break;
+
+    case TypeRef::kArray: {
+        ArrayTypeRef* aref = cast<ArrayTypeRef>(ref);
+        write_u8(kArrayRef);
+        write_typeref(aref->base_type());
+        write_u64(aref->length());
+        break;
+    }
+
+    case TypeRef::kFunction: {
+        FunctionTypeRef* fref = cast<FunctionTypeRef>(ref);
+        ParamTypeRefs* params = fref->params();
+        write_u8(kFunctionRef);
+        write_typeref(fref->return_type());
+        write_location(params->location());
+        write_u8(params->is_vararg());
+        write_u32(params->param_descs_.size());
+        for (auto* r : params->param_descs_) {
+            write_typeref(r);
+        }
+        break;
+    }
+
+    case TypeRef::kStruct:
+        write_u8(kStructRef);
+        write_symbol(cast<StructTypeRef>(ref)->name());
+        write_location(ref->location());
+        break;
+
+    case TypeRef::kUnion:
+        write_u8(kUnionRef);
+        write_symbol(cast<UnionTypeRef>(ref)->name());
+        write_location(ref->location());
+        break;
+
+    case TypeRef::kUser:
+        write_u8(kUserRef);
+        write_symbol(cast<UserTypeRef>(ref)->name());
+        write_location(ref->location());
+        break;
+
+    default:
+        throw string("can not serialize type: ") + ref->to_string();
+    }
+}
+
+void DeclWriter::write_params(Params* params)
+{
+    write_location(params->location());
+    write_u8(params->is_vararg());
+    write_u32(params->param_descs_.size());
+    for (auto* p : params->parameters()) {
+        write_symbol(p->name());
+        write_typeref(p->type_node()->type_ref());
+    }
+}
+
+void DeclWriter::write_slots(const vector<Slot*>& slots)
+{
+    write_u32(slots.size());
+    for (auto* s : slots) {
+        write_symbol(s->name());
+        write_typeref(s->type_ref());
+    }
+}
+
+void DeclWriter::write_expr(ExprNode* expr)
+{
+    switch (expr->kind()) {
+    case Node::kIntegerLiteral: {
+        auto* n = cast<IntegerLiteralNode>(expr);
+        write_u8(kIntegerLiteral);
+        write_location(n->location());
+        write_typeref(n->type_node()->type_ref());
+        write_u64(n->value());
+        break;
+    }
+    case Node::kStringLiteral: {
+        auto* n = cast<StringLiteralNode>(expr);
+        write_u8(kStringLiteral);
+        write_location(n->location());
+        write_typeref(n->type_node()->type_ref());
+        write_string(n->value());
+        break;
+    }
+    case Node::kVariable: {
+        auto* n = cast<VariableNode>(expr);
+        write_u8(kVariable);
+        write_location(n->location());
+        write_symbol(n->name());
+        break;
+    }
+    case Node::kUnaryOp:
+    case Node::kPrefixOp:
+    case Node::kSuffixOp: {
+        auto* n = cast<UnaryOpNode>(expr);
+        write_u8(expr->kind() == Node::kPrefixOp ? kPrefixOp :
+                 expr->kind() == Node::kSuffixOp ? kSuffixOp : kUnaryOp);
+        write_string(n->op());
+        write_expr(n->expr());
+        break;
+    }
+    case Node::kBinaryOp:
+    case Node::kLogicalAnd:
+    case Node::kLogicalOr: {
+        auto* n = cast<BinaryOpNode>(expr);
+        if (expr->kind() == Node::kLogicalAnd) {
+            write_u8(kLogicalAnd);
+        } else if (expr->kind() == Node::kLogicalOr) {
+            write_u8(kLogicalOr);
+        } else {
+            write_u8(kBinaryOp);
+            write_string(n->op());
+        }
+        write_expr(n->left());
+        write_expr(n->right());
+        break;
+    }
+    case Node::kCondExpr: {
+        auto* n = cast<CondExprNode>(expr);
+        write_u8(kCondExpr);
+        write_expr(n->cond());
+        write_expr(n->then_expr());
+        write_expr(n->else_expr());
+        break;
+    }
+    case Node::kCast: {
+        auto* n = cast<CastNode>(expr);
+        write_u8(kCast);
+        write_typeref(n->typde_node()->type_ref());
+        write_expr(n->expr());
+        break;
+    }
+    case Node::kSizeofType:
+        write_u8(kSizeofType);
+        write_typeref(
+            cast<SizeofTypeNode>(expr)->operand_type_node()->type_ref());
+        break;
+    case Node::kSizeofExpr:
+        write_u8(kSizeofExpr);
+        write_expr(cast<SizeofExprNode>(expr)->expr());
+        break;
+    case Node::kAddress:
+        write_u8(kAddress);
+        write_expr(cast<AddressNode>(expr)->expr());
+        break;
+    case Node::kDereference:
+        write_u8(kDereference);
+        write_expr(cast<DereferenceNode>(expr)->expr());
+        break;
+    case Node::kAref: {
+        auto* n = cast<ArefNode>(expr);
+        write_u8(kAref);
+        write_expr(n->expr());
+        write_expr(n->index());
+        break;
+    }
+    case Node::kMember: {
+        auto* n = cast<MemberNode>(expr);
+        write_u8(kMember);
+        write_expr(n->expr());
+        write_symbol(n->member());
+        break;
+    }
+    case Node::kPtrMember: {
+        auto* n = cast<PtrMemberNode>(expr);
+        write_u8(kPtrMember);
+        write_expr(n->expr());
+        write_symbol(n->member());
+        break;
+    }
+    case Node::kFuncall: {
+        auto* n = cast<FuncallNode>(expr);
+        write_u8(kFuncall);
+        write_expr(n->expr());
+        write_u32(n->num_args());
+        for (auto* arg : n->args()) {
+            write_expr(arg);
+        }
+        break;
+    }
+    default:
+        throw string("can not serialize expression: ") + expr->class_name();
+    }
+}
+
+void DeclWriter::write(Declarations* decls)
+{
+    auto funcs = decls->declfuncs();
+    write_u32(funcs.size());
+    for (auto* f : funcs) {
+        auto* ref = (FunctionTypeRef*)f->type_node()->type_ref();
+        write_symbol(f->name());
+        write_typeref(ref->return_type());
+        write_params(f->params());
+    }
+
+    auto vars = decls->declvars();
+    write_u32(vars.size());
+    for (auto* v : vars) {
+        write_symbol(v->name());
+        write_typeref(v->type_node()->type_ref());
+    }
+
+    auto consts = decls->constants();
+    write_u32(consts.size());
+    for (auto* c : consts) {
+        write_symbol(c->name());
+        write_typeref(c->type_node()->type_ref());
+        write_expr(c->value());
+    }
+
+    auto structs = decls->defstructs();
+    write_u32(structs.size());
+    for (auto* s : structs) {
+        write_location(s->location());
+        write_symbol(s->name());
+        write_slots(s->members());
+    }
+
+    auto unions = decls->defunions();
+    write_u32(unions.size());
+    for (auto* u : unions) {
+        write_location(u->location());
+        write_symbol(u->name());
+        write_slots(u->members());
+    }
+
+    auto typedefs = decls->typedefs();
+    write_u32(typedefs.size());
+    for (auto* t : typedefs) {
+        write_location(t->location());
+        write_symbol(t->name());
+        write_typeref(t->real_type_ref());
+    }
+}
+
+void DeclReader::need(size_t n)
+{
+    if ((size_t)(end_ - p_) < n) {
+        throw string("truncated precompiled header");
+    }
+}
+
+uint8_t DeclReader::read_u8()
+{
+    need(1);
+    return (uint8_t)*p_++;
+}
+
+uint32_t DeclReader::read_u32()
+{
+    uint32_t v;
+    need(sizeof(v));
+    memcpy(&v, p_, sizeof(v));
+    p_ += sizeof(v);
+    return v;
+}
+
+uint64_t DeclReader::read_u64()
+{
+    uint64_t v;
+    need(sizeof(v));
+    memcpy(&v, p_, sizeof(v));
+    p_ += sizeof(v);
+    return v;
+}
+
+Symbol DeclReader::read_symbol()
+{
+    return Symbol(read_string());
+}
+
+string DeclReader::read_string()
+{
+    uint32_t n = read_u32();
+    need(n);
+    string s(p_, n);
+    p_ += n;
+    return s;
+}
+
+Location DeclReader::read_location()
+{
+    bool known = read_u8();
+    uint32_t offset = read_u32();
+    return Location(known ? file_ : 0, offset);
+}
+
+// gives the references up to a constructor that takes them over
+template<typename T>
+static vector<T*> release_all(vector<RefPtr<T>>& v)
+{
+    vector<T*> raw;
+    raw.reserve(v.size());
+    for (auto& p : v) {
+        raw.push_back(p.release());
+    }
+    return raw;
+}
+
+/* A truncated or corrupted entry makes the reader throw in the middle
+ * of a declaration, so whatever has been read so far is held by a
+ * RefPtr until it is handed to the node that takes it.
+ */
+TypeRef* DeclReader::read_typeref()
+{
+    switch (read_u8()) {
+    case kVoidRef: {
+        Location loc = read_location();
+        return new VoidTypeRef(loc);
+    }
+
+    case kIntegerRef: {
+        string name = read_string();
+        Location loc = read_location();
+        return new IntegerTypeRef(name, loc);
+    }
+
+    case kPointerRef: {
+        auto base = RefPtr<TypeRef>::adopt(read_typeref());
+        return new PointerTypeRef(base.get());
+    }
+
+    case kArrayRef: {
+        auto base = RefPtr<TypeRef>::adopt(read_typeref());
+        long length = (long)read_u64();
+        return length == -1 ? new ArrayTypeRef(base.get()) :
+                              new ArrayTypeRef(base.get(), length);
+    }
+
+    case kFunctionRef: {
+        auto ret = RefPtr<TypeRef>::adopt(read_typeref());
+        Location loc = read_location();
+        bool vararg = read_u8();
+        uint32_t n = read_u32();
+        vector<RefPtr<TypeRef>> v;
+        for (uint32_t i = 0; i < n; ++i) {
+            v.push_back(RefPtr<TypeRef>::adopt(read_typeref()));
+        }
+        auto params = RefPtr<ParamTypeRefs>::adopt(
+            new ParamTypeRefs(loc, release_all(v), vararg));
+        return new FunctionTypeRef(ret.get(), params.get());
+    }
+
+    case kStructRef: {
+        Symbol name = read_symbol();
+        Location loc = read_location();
+        return new StructTypeRef(loc, name);
+    }
+
+    case kUnionRef: {
+        Symbol name = read_symbol();
+        Location loc = read_location();
+        return new UnionTypeRef(loc, name);
+    }
+
+    case kUserRef: {
+        Symbol name = read_symbol();
+        Location loc = read_location();
+        return new UserTypeRef(loc, name);
+    }
+    }
+    throw string("bad type in precompiled header");
+}
+
+Params* DeclReader::read_params()
+{
+    Location loc = read_location();
+    bool vararg = read_u8();
+    uint32_t n = read_u32();
+    vector<RefPtr<Parameter>> v;
+    for (uint32_t i = 0; i < n; ++i) {
+        Symbol name = read_symbol();
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        v.push_back(RefPtr<Parameter>::adopt(new Parameter(type.get(), name)));
+    }
+    auto* params = new Params(loc, release_all(v));
+    if (vararg) {
+        params->accept_varargs();
+    }
+    return params;
+}
+
+vector<Slot*> DeclReader::read_slots()
+{
+    uint32_t n = read_u32();
+    vector<RefPtr<Slot>> v;
+    for (uint32_t i = 0; i < n; ++i) {
+        Symbol name = read_symbol();
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        v.push_back(RefPtr<Slot>::adopt(new Slot(type.get(), name)));
+    }
+    return release_all(v);
+}
+
+ExprNode* DeclReader::read_expr()
+{
+    typedef RefPtr<ExprNode> Expr;
+    uint8_t tag = read_u8();
+    switch (tag) {
+    case kIntegerLiteral: {
+        Location loc = read_location();
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        long value = (long)read_u64();
+        return new IntegerLiteralNode(loc, ref.get(), value);
+    }
+
+    case kStringLiteral: {
+        Location loc = read_location();
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        ConstantEntry* entry = constants_.intern(read_string());
+        return new StringLiteralNode(loc, ref.get(), entry);
+    }
+
+    case kVariable: {
+        Location loc = read_location();
+        Symbol name = read_symbol();
+        return new VariableNode(loc, name);
+    }
+
+    case kUnaryOp:
+    case kPrefixOp:
+    case kSuffixOp: {
+        string op = read_string();
+        Expr expr = Expr::adopt(read_expr());
+        if (tag == kPrefixOp) {
+            return new PrefixOpNode(op, expr.get());
+        } else if (tag == kSuffixOp) {
+            return new SuffixOpNode(op, expr.get());
+        }
+        return new UnaryOpNode(op, expr.get());
+    }
+
+    case kBinaryOp:
+    case kLogicalAnd:
+    case kLogicalOr: {
+        string op = tag == kBinaryOp ? read_string() : "";
+        Expr left = Expr::adopt(read_expr());
+        Expr right = Expr::adopt(read_expr());
+        if (tag == kLogicalAnd) {
+            return new LogicalAndNode(left.get(), right.get());
+        } else if (tag == kLogicalOr) {
+            return new LogicalOrNode(left.get(), right.get());
+        }
+        return new BinaryOpNode(left.get(), op, right.get());
+    }
+
+    case kCondExpr: {
+        Expr c = Expr::adopt(read_expr());
+        Expr t = Expr::adopt(read_expr());
+        Expr f = Expr::adopt(read_expr());
+        return new CondExprNode(c.get(), t.get(), f.get());
+    }
+
+    case kCast: {
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        Expr expr = Expr::adopt(read_expr());
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        return new CastNode(type.get(), expr.get());
+    }
+
+    case kSizeofType: {
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        auto ulong = RefPtr<TypeRef>::adopt(IntegerTypeRef::ulong_ref());
+        return new SizeofTypeNode(type.get(), ulong.get());
+    }
+
+    case kSizeofExpr: {
+        Expr expr = Expr::adopt(read_expr());
+        auto ulong = RefPtr<TypeRef>::adopt(IntegerTypeRef::ulong_ref());
+        return new SizeofExprNode(expr.get(), ulong.get());
+    }
+
+    case kAddress:
+    case kDereference: {
+        Expr expr = Expr::adopt(read_expr());
+        if (tag == kAddress) {
+            return new AddressNode(expr.get());
+        }
+        return new DereferenceNode(expr.get());
+    }
+
+    case kAref: {
+        Expr expr = Expr::adopt(read_expr());
+        Expr index = Expr::adopt(read_expr());
+        return new ArefNode(expr.get(), index.get());
+    }
+
+    case kMember:
+    case kPtrMember: {
+        Expr expr = Expr::adopt(read_expr());
+        Symbol member = read_symbol();
+        if (tag == kMember) {
+            return new MemberNode(expr.get(), member);
+        }
+        return new PtrMemberNode(expr.get(), member);
+    }
+
+    case kFuncall: {
+        Expr expr = Expr::adopt(read_expr());
+        uint32_t n = read_u32();
+        vector<Expr> args;
+        for (uint32_t i = 0; i < n; ++i) {
+            args.push_back(Expr::adopt(read_expr()));
+        }
+        return new FuncallNode(expr.get(), release_all(args));
+    }
+    }
+    throw string("bad expression in precompiled header");
+}
+
+Declarations* DeclReader::read()
+{
+    auto decls = RefPtr<Declarations>::adopt(new Declarations);
+
+    uint32_t n = read_u32();
+    for (uint32_t i = 0; i < n; ++i) {
+        Symbol name = read_symbol();
+        auto ret = RefPtr<TypeRef>::adopt(read_typeref());
+        auto params = RefPtr<Params>::adopt(read_params());
+        auto tref = RefPtr<ParamTypeRefs>::adopt(params->parameter_typerefs());
+        auto ref = RefPtr<TypeRef>::adopt(
+            new FunctionTypeRef(ret.get(), tref.get()));
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        auto f = RefPtr<UndefinedFunction>::adopt(
+            new UndefinedFunction(type.get(), name, params.get()));
+        decls->add_declfunc(f.get());
+    }
+
+    n = read_u32();
+    for (uint32_t i = 0; i < n; ++i) {
+        Symbol name = read_symbol();
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        auto v = RefPtr<UndefinedVariable>::adopt(
+            new UndefinedVariable(type.get(), name));
+        decls->add_declvar(v.get());
+    }
+
+    n = read_u32();
+    for (uint32_t i = 0; i < n; ++i) {
+        Symbol name = read_symbol();
+        auto ref = RefPtr<TypeRef>::adopt(read_typeref());
+        auto value = RefPtr<ExprNode>::adopt(read_expr());
+        auto type = RefPtr<TypeNode>::adopt(new TypeNode(ref.get()));
+        auto c = RefPtr<Constant>::adopt(
+            new Constant(type.get(), name, value.get()));
+        decls->add_constant(c.get());
+    }
+
+    n = read_u32();
+    for (uint32_t i = 0; i < n; ++i) {
+        Location loc = read_location();
+        Symbol name = read_symbol();
+        vector<Slot*> membs = read_slots();
+        auto p = RefPtr<TypeRef>::adopt(new StructTypeRef(name));
+        auto s = RefPtr<StructNode>::adopt(
+            new StructNode(loc, p.get(), name, move(membs)));
+        decls->add_defstruct(s.get());
+    }
+
+    n = read_u32();
+    for (uint32_t i = 0; i < n; ++i) {
+        Location loc = read_location();
+        Symbol name = read_symbol();
+        vector<Slot*> membs = read_slots();
+        auto p = RefPtr<TypeRef>::adopt(new UnionTypeRef(name));
+        auto u = RefPtr<UnionNode>::adopt(
+            new UnionNode(loc, p.get(), name, move(membs)));
+        decls->add_defunion(u.get());
+    }
+
+    n = read_u32();
+    for (uint32_t i = 0; i < n; ++i) {
+        Location loc = read_location();
+        Symbol name = read_symbol();
+        auto real = RefPtr<TypeRef>::adopt(read_typeref());
+        auto t = RefPtr<TypedefNode>::adopt(
+            new TypedefNode(loc, real.get(), name));
+        decls->add_typedef(t.get());
+    }
+    return decls.release();
+}
+
+} // namespace cbc
@@ -1,5 +1,6 @@
 #include "type.h"
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 
@@ -11,7 +12,7 @@ namespace cbc {
 
 CompositeType* Type::get_composite_type()
 {
-    CompositeType* type = dynamic_cast<CompositeType*>(this);
+    CompositeType* type = dyn_cast<CompositeType>(this);
     if (type == nullptr) {
         throw "not a composite type";
     }
@@ -20,7 +21,7 @@ CompositeType* Type::get_composite_type()
 
 PointerType* Type::get_pointer_type() 
 { 
-    PointerType* type = dynamic_cast<PointerType*>(this);
+    PointerType* type = dyn_cast<PointerType>(this);
     if (type == nullptr) {
         throw "not a pointer type";
     }
@@ -29,7 +30,7 @@ PointerType* Type::get_pointer_type()
 
 FunctionType* Type::get_function_type()
 {
-    FunctionType* type = dynamic_cast<FunctionType*>(this);
+    FunctionType* type = dyn_cast<FunctionType>(this);
     if (type == nullptr) {
         throw "not a function type";
     }
@@ -38,7 +39,7 @@ FunctionType* Type::get_function_type()
 
 IntegerType* Type::get_integer_type()
 {
-    IntegerType* type = dynamic_cast<IntegerType*>(this);
+    IntegerType* type = dyn_cast<IntegerType>(this);
     if (type == nullptr) {
         throw "not an integer type";
     }
@@ -47,7 +48,7 @@ IntegerType* Type::get_integer_type()
 
 StructType* Type::get_struct_type()
 {
-    StructType* type = dynamic_cast<StructType*>(this);
+    StructType* type = dyn_cast<StructType>(this);
     if (type == nullptr) {
         throw "not a struct type";
     }
@@ -56,7 +57,7 @@ StructType* Type::get_struct_type()
 
 UnionType* Type::get_union_type()
 {
-    UnionType* type = dynamic_cast<UnionType*>(this);
+    UnionType* type = dyn_cast<UnionType>(this);
     if (type == nullptr) {
         throw "not a union type";
     }
@@ -65,20 +66,59 @@ UnionType* Type::get_union_type()
 
 ArrayType* Type::get_array_type()
 {
-    ArrayType* type = dynamic_cast<ArrayType*>(this);
+    ArrayType* type = dyn_cast<ArrayType>(this);
     if (type == nullptr) {
         throw "not an array type";
     }
     return type;
 }
 
-bool IntegerTypeRef::equals(Object* other)
+bool TypeRef::equals(Object* other)
 {
-    IntegerTypeRef* ref = dynamic_cast<IntegerTypeRef*>(other);
-    if (!ref)
+    // only another ref knows its kind
+    TypeRef* ref = dynamic_cast<TypeRef*>(other);
+    return ref && equals(ref);
+}
+
+bool TypeRef::equals(TypeRef* other)
+{
+    if (other == this)
+        return true;
+    if (kind_ != other->kind_ || hash_ != other->hash_)
         return false;
 
-    return ref->name() == name();
+    switch (kind_) {
+    case kVoid:
+        return true;
+    case kInteger:
+        return cast<IntegerTypeRef>(this)->name() ==
+            cast<IntegerTypeRef>(other)->name();
+    case kPointer:
+        return cast<PointerTypeRef>(this)->base_type()->equals(
+            cast<PointerTypeRef>(other)->base_type());
+    case kStruct:
+        return cast<StructTypeRef>(this)->name() ==
+            cast<StructTypeRef>(other)->name();
+    case kUnion:
+        return cast<UnionTypeRef>(this)->name() ==
+            cast<UnionTypeRef>(other)->name();
+    case kUser:
+        return cast<UserTypeRef>(this)->name() ==
+            cast<UserTypeRef>(other)->name();
+    case kArray: {
+        ArrayTypeRef* a = cast<ArrayTypeRef>(this);
+        ArrayTypeRef* b = cast<ArrayTypeRef>(other);
+        return a->length() == b->length() &&
+            a->base_type()->equals(b->base_type());
+    }
+    case kFunction: {
+        FunctionTypeRef* f = cast<FunctionTypeRef>(this);
+        FunctionTypeRef* g = cast<FunctionTypeRef>(other);
+        return f->return_type()->equals(g->return_type()) &&
+            f->params()->equals(g->params());
+    }
+    }
+    return false;
 }
 
 IntegerTypeRef* IntegerTypeRef::char_ref(const Location& loc) 
@@ -161,18 +201,13 @@ IntegerTypeRef* IntegerTypeRef::ulong_ref()
     return new IntegerTypeRef("unsigned long");
 }
 
-bool VoidTypeRef::equals(Object* other)
-{
-    return !!dynamic_cast<VoidTypeRef*>(other); 
-}
-
 bool VoidType::equals(Object* other)
 {
     return !!dynamic_cast<VoidType*>(other);
 }
 
 IntegerType::IntegerType(long size, bool is_signed, const string& name) :
-    size_(size), is_signed_(is_signed), name_(name)
+    Type(kInteger), size_(size), is_signed_(is_signed), name_(name)
 {
 }
 
@@ -203,15 +238,16 @@ bool IntegerType::is_castable_to(Type* target)
     return (target->is_integer() || target->is_pointer());
 }
 
-NamedType::NamedType(const string& name, const Location& loc)
-    : name_(name), loc_(loc)
+NamedType::NamedType(Kind kind, Symbol name, const Location& loc)
+    : Type(kind), name_(name), loc_(loc)
 {
 }
 
 PointerTypeRef::PointerTypeRef(TypeRef* base) :
-        TypeRef(base->location()), base_type_(base)
+        TypeRef(kPointer, base->location()), base_type_(base)
 {
     base_type_->inc_ref();
+    hash_ = hash_combine(hash_, base_type_->hash());
 }
 
 PointerTypeRef::~PointerTypeRef()
@@ -219,18 +255,8 @@ PointerTypeRef::~PointerTypeRef()
     base_type_->dec_ref();
 }
 
-bool PointerTypeRef::equals(Object* other)
-{
-    PointerTypeRef* ref = dynamic_cast<PointerTypeRef*>(other);
-    if (!ref)
-        return false;
-        
-    return base_type_->equals(ref->base_type_);
-} 
-
 TypeRef* PointerTypeRef::base_type() 
 { 
-    base_type_->inc_ref(); 
     return base_type_; 
 }
 
@@ -240,7 +266,7 @@ string PointerTypeRef::to_string() const
 }
 
 PointerType::PointerType(long size, Type* base_type)
-    : size_(size), base_type_(base_type)
+    : Type(kPointer), size_(size), base_type_(base_type)
 {
     base_type_->inc_ref();
 }
@@ -252,7 +278,6 @@ PointerType::~PointerType()
 
 Type* PointerType::base_type() 
 { 
-    base_type_->inc_ref(); 
     return base_type_; 
 }
 
@@ -267,6 +292,10 @@ bool PointerType::equals(Object* other)
 
 bool PointerType::is_same_type(Type* type)
 {
+    // the same unless typedef names are in the way, see TypeTable
+    if (type == this)
+        return true;
+
     if (!type->is_pointer())
         return false;
 
@@ -275,6 +304,9 @@ bool PointerType::is_same_type(Type* type)
 
 bool PointerType::is_compatible(Type* other)
 {
+    if (other == this)
+        return true;
+
     if (!other->is_pointer()) 
         return false;
         
@@ -293,14 +325,16 @@ bool PointerType::is_castable_to(Type* other)
     return other->is_pointer() || other->is_integer();
 }
     
-CompositeType::CompositeType(const string& name, 
+CompositeType::CompositeType(Kind kind, Symbol name, 
         vector<Slot*>&& membs, const Location& loc) : 
-    NamedType(name, loc), members_(move(membs)),
+    NamedType(kind, name, loc), members_(move(membs)),
     cached_size_(Type::kSizeUnknown),
-    cached_align_(Type::kSizeUnknown)
+    cached_align_(Type::kSizeUnknown),
+    in_layout_(false), is_recursive_checked_(false)
 {
-    for (auto* s : members_) {
-        // s->inc_ref();
+    index_.reserve(members_.size());
+    for (size_t i = 0; i < members_.size(); ++i) {
+        index_.emplace(members_[i]->name(), i);
     }
 }
 
@@ -313,83 +347,72 @@ CompositeType::~CompositeType()
 
 bool CompositeType::is_same_type(Type* other)
 {
-    return compare_member_types(other, "is_same_type");
+    return compare_member_types(other, &Type::is_same_type);
 }
 
 bool CompositeType::is_compatible(Type* target)
 {
-    return compare_member_types(target, "is_compatible");
+    return compare_member_types(target, &Type::is_compatible);
 }
     
 bool CompositeType::is_castable_to(Type* target)
 {
-    return compare_member_types(target, "is_castable_to");
+    return compare_member_types(target, &Type::is_castable_to);
 }
     
 long CompositeType::size()
 {
-    if (cached_size_ == Type::kSizeUnknown) {
-        compute_offsets();
-    }
+    layout();
     return cached_size_;
 }
     
-long CompositeType::alignmemt()
+long CompositeType::alignment()
 {
-    if (cached_align_ == Type::kSizeUnknown) {
-        compute_offsets();
-    }
+    layout();
     return cached_align_;
 }
-    
-vector<Slot*> CompositeType::members()
+
+void CompositeType::layout()
 {
-    vector<Slot*> v;
-    for (auto m : members_) {
-        m->inc_ref();
-        v.push_back(m);
+    if (cached_size_ != Type::kSizeUnknown) {
+        return;
     }
-    return v;
-}
-    
-vector<Type*> CompositeType::member_types()
-{
-    vector<Type*> v;
-    for (auto m : members_) {
-        m->type()->inc_ref();
-        v.push_back(m->type());
+    if (in_layout_) {
+        throw string("recursive definition: " + to_string());
     }
-    return v;
+    in_layout_ = true;
+    try {
+        compute_offsets();
+    } catch (...) {
+        in_layout_ = false;
+        throw;
+    }
+    in_layout_ = false;
 }
     
-bool CompositeType::has_member(const string& name)
+bool CompositeType::has_member(Symbol name)
 {
-    auto s = get(name);
-    bool b = s->name() != "";
-    s->dec_ref();
-    return b;
+    return get(name) != nullptr;
 }
     
-Type* CompositeType::member_type(const string& name)
+Type* CompositeType::member_type(Symbol name)
 {
-    auto s = get(name);
-    auto tp = s->type();
-    tp->inc_ref();
-    s->dec_ref();
-    return tp;
+    return fetch(name)->type();
 }
     
-long CompositeType::member_offset(const string& name)
+long CompositeType::member_offset(Symbol name)
 {
     auto s = fetch(name);
-    if (s->offset() == Type::kSizeUnknown) {
-        compute_offsets();
-    }
+    layout();
     return s->offset();
 }
     
-bool CompositeType::compare_member_types(Type* other, const string& method)
+bool CompositeType::compare_member_types(Type* other,
+                                         bool (Type::*method)(Type*))
 {
+    if (other == this)
+        return true;
+
     if (is_struct() && !other->is_struct()) 
         return false;
         
@@ -397,31 +420,19 @@ bool CompositeType::compare_member_types(Type* other, const string& method)
         return false;
         
     CompositeType* other_type = other->get_composite_type();
-    if (members_.size() != other->size()) 
+    auto& other_members = other_type->members();
+    if (members_.size() != other_members.size()) 
         return false;
         
-    auto other_types = other_type->member_types().begin();
-    for (auto* t : member_types()) {
-        if (!compare_types_by(method, t, *other_types)) {
+    for (size_t i = 0; i < members_.size(); ++i) {
+        if (!(members_[i]->type()->*method)(other_members[i]->type())) {
             return false;
         }
-        ++other_types;
     }
     return true;
 }
-    
-bool CompositeType::compare_types_by(const string& method, Type* t, Type* tt)
-{
-    if (method == "is_same_type")
-        return t->is_same_type(tt);
-    if (method == "is_compatible")
-        return t->is_compatible(tt);
-    if (method == "is_castable_to")
-        return t->is_castable_to(tt);
-    throw string("unknown method: ") + method; 
-}
         
-Slot* CompositeType::fetch(const string& name)
+Slot* CompositeType::fetch(Symbol name)
 {
     auto s = get(name);
     if (s == nullptr)
@@ -429,20 +440,21 @@ Slot* CompositeType::fetch(const string& name)
     return s;
 }
     
-Slot* CompositeType::get(const string& name)
+Slot* CompositeType::get(Symbol name)
 {
-    for (auto* s : members_) {
-        if (s->name() == name) {
-            s->inc_ref();
-            return s;
-        }
-    }
-    return nullptr;
+    auto it = index_.find(name);
+    return it != index_.end() ? members_[it->second] : nullptr;
+}
+
+// n rounded up to a multiple of alignment
+static long align(long n, long alignment)
+{
+    return (n + alignment - 1) / alignment * alignment;
 }
 
-StructType::StructType(const string& name, 
+StructType::StructType(Symbol name, 
         vector<Slot*>&& membs, const Location& loc) : 
-    CompositeType(name, move(membs), loc)
+    CompositeType(kStruct, name, move(membs), loc)
 {
 }
     
@@ -456,31 +468,34 @@ bool StructType::is_same_type(Type* other)
 
 void StructType::compute_offsets() 
 {
-    throw string("Not implement!");
+    long offset = 0;
+    long max_align = 1;
+    for (auto* s : members_) {
+        long a = max(s->alignment(), 1L);
+        offset = align(offset, a);
+        s->set_offset(offset);
+        offset += s->alloc_size();
+        max_align = max(max_align, a);
+    }
+    cached_size_ = align(offset, max_align);
+    cached_align_ = max_align;
 }
 
-StructTypeRef::StructTypeRef(const string& name) : 
-    name_(name)
+StructTypeRef::StructTypeRef(Symbol name) : 
+    TypeRef(kStruct), name_(name)
 {
+    hash_ = hash_combine(hash_, std::hash<Symbol>()(name_));
 }
     
-StructTypeRef::StructTypeRef(const Location& loc, const string& name) : 
-    TypeRef(loc), name_(name)
+StructTypeRef::StructTypeRef(const Location& loc, Symbol name) : 
+    TypeRef(kStruct, loc), name_(name)
 {
+    hash_ = hash_combine(hash_, std::hash<Symbol>()(name_));
 }
 
-bool StructTypeRef::equals(Object* other)
-{
-    StructTypeRef* ref = dynamic_cast<StructTypeRef*>(other);
-    if (!ref)
-        return false;
-
-    return name() == ref->name();
-}
-    
-UnionType::UnionType(const string& name, 
+UnionType::UnionType(Symbol name, 
         vector<Slot*>&& membs, const Location& loc) : 
-    CompositeType(name, move(membs), loc)
+    CompositeType(kUnion, name, move(membs), loc)
 {
 }
 
@@ -494,49 +509,43 @@ bool UnionType::is_same_type(Type* other)
 
 void UnionType::compute_offsets()
 {
-    throw string("Not implement!");
-}
-
-UnionTypeRef::UnionTypeRef(const string& name) : 
-    name_(name)
-{
+    long max_size = 0;
+    long max_align = 1;
+    for (auto* s : members_) {
+        s->set_offset(0);
+        max_size = max(max_size, s->alloc_size());
+        max_align = max(max_align, max(s->alignment(), 1L));
+    }
+    cached_size_ = align(max_size, max_align);
+    cached_align_ = max_align;
 }
 
-UnionTypeRef::UnionTypeRef(const Location& loc, const string& name) : 
-    TypeRef(loc), name_(name)
+UnionTypeRef::UnionTypeRef(Symbol name) : 
+    TypeRef(kUnion), name_(name)
 {
+    hash_ = hash_combine(hash_, std::hash<Symbol>()(name_));
 }
 
-bool UnionTypeRef::equals(Object* other)
+UnionTypeRef::UnionTypeRef(const Location& loc, Symbol name) : 
+    TypeRef(kUnion, loc), name_(name)
 {
-    UnionTypeRef* ref = dynamic_cast<UnionTypeRef*>(other);
-    if (!ref)
-        return false;
-
-    return name() == ref->name();
+    hash_ = hash_combine(hash_, std::hash<Symbol>()(name_));
 }
 
-UserTypeRef::UserTypeRef(const string& name) : 
-    name_(name)
+UserTypeRef::UserTypeRef(Symbol name) : 
+    TypeRef(kUser), name_(name)
 {
+    hash_ = hash_combine(hash_, std::hash<Symbol>()(name_));
 }
     
-UserTypeRef::UserTypeRef(const Location& loc, const string& name) : 
-    TypeRef(loc), name_(name)
+UserTypeRef::UserTypeRef(const Location& loc, Symbol name) : 
+    TypeRef(kUser, loc), name_(name)
 {
+    hash_ = hash_combine(hash_, std::hash<Symbol>()(name_));
 }
 
-bool UserTypeRef::equals(Object* other)
-{
-    UserTypeRef* ref = dynamic_cast<UserTypeRef*>(other);
-    if (!ref)
-        return false;
-
-    return name() == ref->name();
-}
-
-UserType::UserType(const string& name, TypeNode* real, const Location& loc):
-    NamedType(name, loc), real_(real)
+UserType::UserType(Symbol name, TypeNode* real, const Location& loc):
+    NamedType(kUser, name, loc), real_(real)
 {
     real_->inc_ref();
 }
@@ -548,23 +557,24 @@ UserType::~UserType()
 
 Type* UserType::real_type()
 { 
-    real_->type()->inc_ref();
     return real_->type(); 
 }
 
 ArrayTypeRef::ArrayTypeRef(TypeRef* base) : 
-    TypeRef(base->location()), base_type_(base), length_(-1)
+    TypeRef(kArray, base->location()), base_type_(base), length_(-1)
 {
     base_type_->inc_ref();
+    hash_ = hash_combine(hash_combine(hash_, base_type_->hash()), length_);
 }
     
 ArrayTypeRef::ArrayTypeRef(TypeRef* base, long length) : 
-    TypeRef(base->location()), base_type_(base), length_(length)
+    TypeRef(kArray, base->location()), base_type_(base), length_(length)
 {
     base_type_->inc_ref();
 
     if (length < 0) 
         throw string("negative array length");
+    hash_ = hash_combine(hash_combine(hash_, base_type_->hash()), length_);
 }
 
 ArrayTypeRef::~ArrayTypeRef()
@@ -573,13 +583,13 @@ ArrayTypeRef::~ArrayTypeRef()
 }
 
 ArrayType::ArrayType(Type* base_type, long pointer_size) :
-    base_type_(base_type), length_(-1), pointer_size_(pointer_size)
+    Type(kArray), base_type_(base_type), length_(-1), pointer_size_(pointer_size)
 {
     base_type_->inc_ref();
 }
 
 ArrayType::ArrayType(Type* base_type, long length, long pointer_size) :
-    base_type_(base_type), length_(length), pointer_size_(pointer_size)
+    Type(kArray), base_type_(base_type), length_(length), pointer_size_(pointer_size)
 {
     base_type_->inc_ref();
 }
@@ -597,6 +607,9 @@ bool ArrayType::is_allocated_array()
 
 bool ArrayType::is_same_type(Type* other)
 {
+    if (other == this)
+        return true;
+
     if (!other->is_pointer() && !other->is_array())
         return false;
     
@@ -630,12 +643,6 @@ string ArrayType::to_string() const
     }
 }
 
-bool ArrayTypeRef::equals(Object* other)
-{
-    ArrayTypeRef* ref = dynamic_cast<ArrayTypeRef*>(other);
-    return ref && ref->length_ == length_;
-}
-    
 string ArrayTypeRef::to_string() const
 {
     return base_type_->to_string() + \
@@ -665,9 +672,9 @@ ParamTypes* ParamTypeRefs::intern_types(TypeTable* table)
 {
     vector<Type*> v;
     for (TypeRef* ref : param_descs_) {
-        auto type = table->get_param_type(ref);
-        type->inc_ref();
-        v.push_back(type);
+        Type* t = table->get_param_type(ref);
+        t->inc_ref();
+        v.push_back(t);
     }
     return new ParamTypes(loc_, move(v), vararg_);
 }
@@ -692,6 +699,21 @@ ParamTypes::ParamTypes(const Location& loc, vector<Type*>&& param_descs, bool va
 {
 }
 
+bool ParamTypes::is_same_type(ParamTypes* other)
+{
+    if (vararg_ != other->vararg_)
+        return false;
+
+    if (param_descs_.size() != other->param_descs_.size())
+        return false;
+
+    for (size_t i = 0; i < param_descs_.size(); ++i) {
+        if (!param_descs_[i]->is_same_type(other->param_descs_[i]))
+            return false;
+    }
+    return true;
+}
+
 bool ParamTypes::equals(Object* other)
 {
     ParamTypes* ref = dynamic_cast<ParamTypes*>(other);
@@ -715,10 +737,18 @@ bool ParamTypes::equals(ParamTypes* other)
 
 FunctionTypeRef::FunctionTypeRef(TypeRef* return_type, 
         ParamTypeRefs* params) :
-    TypeRef(return_type->location()), return_type_(return_type), params_(params)
+    TypeRef(kFunction, return_type->location()), return_type_(return_type),
+    params_(params)
 {
     return_type_->inc_ref();
     params_->inc_ref();
+
+    // the parameters are complete by now, varargs included
+    hash_ = hash_combine(hash_, return_type_->hash());
+    for (TypeRef* ref : params_->param_descs_) {
+        hash_ = hash_combine(hash_, ref->hash());
+    }
+    hash_ = hash_combine(hash_, params_->is_vararg());
 }
 
 FunctionTypeRef::~FunctionTypeRef()
@@ -727,18 +757,6 @@ FunctionTypeRef::~FunctionTypeRef()
     params_->dec_ref();
 }
 
-bool FunctionTypeRef::equals(Object* other)
-{
-    FunctionTypeRef* ref = dynamic_cast<FunctionTypeRef*>(other);
-    return ref && equals(ref);
-}
-
-bool FunctionTypeRef::equals(FunctionTypeRef* ref)
-{
-    return ref->return_type_->equals(return_type_) &&
-            ref->params_->equals(params_);
-}
-
 string FunctionTypeRef::to_string() const
 {
     stringstream ss;
@@ -754,7 +772,7 @@ string FunctionTypeRef::to_string() const
 }
 
 FunctionType::FunctionType(Type* ret, ParamTypes* param_types) :
-    return_type_(ret), param_types_(param_types)
+    Type(kFunction), return_type_(ret), param_types_(param_types)
 {
     return_type_->inc_ref();
     param_types_->inc_ref();
@@ -768,7 +786,16 @@ FunctionType::~FunctionType()
 
 bool FunctionType::is_same_type(Type* type)
 {
-    return false;
+    // the same unless typedef names are in the way, see TypeTable
+    if (type == this)
+        return true;
+
+    if (!type->is_function())
+        return false;
+
+    FunctionType* other = type->get_function_type();
+    return return_type_->is_same_type(other->return_type_) &&
+        param_types_->is_same_type(other->param_types_);
 }
 
 } // namespace cbc
\ No newline at end of file
@@ -0,0 +1,32 @@
+#!/bin/bash
+#
+# expr.sh - times may on a generated file of nested expressions,
+# about 6.8 MB with the default of 3000 functions. Most of the time
+# goes to the expression rules of the parser and to scanning.
+#
+#   ./expr.sh [functions] [runs]
+#
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+MAY=${MAY:-$BENCH/../may}
+FUNCS=${1:-3000}
+RUNS=${2:-7}
+INPUT=${TMPDIR:-/tmp}/may-bench-expr-$FUNCS.cb
+
+if [ ! -f "$INPUT" ]
+then
+    python3 "$BENCH/gen_expr.py" 1 "$FUNCS" >"$INPUT" || exit 1
+fi
+
+best=
+for i in $(seq "$RUNS")
+do
+    start=$(date +%s%N)
+    "$MAY" "$INPUT" >/dev/null || exit 1
+    ms=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$ms" -lt "$best" ]
+    then
+        best=$ms
+    fi
+done
+echo "expr: $(wc -c <"$INPUT") bytes, best of $RUNS runs: $best ms"
@@ -0,0 +1,52 @@
+# gen_expr.py SEED N
+#
+# Prints a source of N functions, each with ten assignments of random
+# nested expressions, for timing the expression rules of the parser.
+# The output only depends on SEED and N.
+
+import random
+import sys
+
+OPS = ['||', '&&', '>', '<', '>=', '<=', '==', '!=', '|', '^', '&',
+       '>>', '<<', '+', '-', '*', '/', '%']
+LEAVES = ['a', 'b', 'c', '1', '2', 'x[1]', 'f(a, b)', 'p->m', 's.m']
+
+
+def term(d):
+    r = random.random()
+    if d <= 0 or r < 0.3:
+        return random.choice(LEAVES)
+    if r < 0.4:
+        return random.choice(['-', '!', '~', '*', '&', '++']) + term(d - 1)
+    if r < 0.5:
+        return '(' + expr(d - 1) + ')'
+    if r < 0.55:
+        return '(int)' + term(d - 1)
+    return term(d - 1)
+
+
+def expr(d):
+    if d <= 0:
+        return term(0)
+    r = random.random()
+    if r < 0.1:
+        return expr(d - 1) + ' ? ' + expr(d - 1) + ' : ' + expr(d - 1)
+    if r < 0.15:
+        return '(' + term(0) + ' = ' + expr(d - 1) + ')'
+    if r < 0.2:
+        return '(' + term(0) + ' += ' + expr(d - 1) + ')'
+    return expr(d - 1) + ' ' + random.choice(OPS) + ' ' + expr(d - 1)
+
+
+def main():
+    random.seed(int(sys.argv[1]))
+    n = int(sys.argv[2])
+    print('int f(int a, int b) { return a; }')
+    for i in range(n):
+        print('int g%d(int a, int b, int c) {' % i)
+        for j in range(10):
+            print('    a = %s;' % expr(5))
+        print('    return a;\n}')
+
+
+main()
@@ -0,0 +1,89 @@
+// type_table.cc
+//
+// Times TypeTable::get() on pointer-to-array function type refs. Misses
+// resolve a new structure and hits find one by another equal ref.
+//
+//   ./type_table [types] [rounds]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "node.h"
+#include "type_table.h"
+
+using namespace cbc;
+
+// a new ref each time, equal to the others made with the same k:
+// int (*(*)[k])(long, char*)
+static TypeRef* make_ref(long k)
+{
+    TypeRef* i = IntegerTypeRef::int_ref();
+    TypeRef* elem = new ArrayTypeRef(i, k);
+    TypeRef* ptr = new PointerTypeRef(elem);
+    TypeRef* ret = new PointerTypeRef(ptr);
+    TypeRef* c = IntegerTypeRef::char_ref();
+
+    // the params take over the refs they are given
+    auto* params = new ParamTypeRefs(Location(),
+            {IntegerTypeRef::long_ref(), new PointerTypeRef(c)}, false);
+    TypeRef* ref = new FunctionTypeRef(ret, params);
+
+    i->dec_ref();
+    elem->dec_ref();
+    ptr->dec_ref();
+    ret->dec_ref();
+    c->dec_ref();
+    params->dec_ref();
+    return ref;
+}
+
+// keeps the sizes read from being optimized away
+static volatile long sink;
+
+int main(int argc, char** argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 2000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    const int kHits = 100;
+    double miss = 1e9, hit = 1e9;
+    long sum = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        TypeTable* table = TypeTable::lp64();
+        vector<TypeRef*> first, second;
+        for (int k = 0; k < n; k++) {
+            first.push_back(make_ref(k));
+            second.push_back(make_ref(k));
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (auto* ref : first) {
+            sum += table->get(ref)->size();
+        }
+        chrono::duration<double> d = chrono::steady_clock::now() - start;
+        miss = min(miss, d.count() * 1e9 / n);
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < kHits; i++) {
+            for (auto* ref : second) {
+                sum += table->get(ref)->size();
+            }
+        }
+        d = chrono::steady_clock::now() - start;
+        hit = min(hit, d.count() * 1e9 / n / kHits);
+
+        delete table;
+        for (auto* ref : first) {
+            ref->dec_ref();
+        }
+        for (auto* ref : second) {
+            ref->dec_ref();
+        }
+    }
+    sink = sum;
+    printf("TypeTable::get: miss %.1f ns, hit %.1f ns (best of %d rounds, "
+           "%d types)\n", miss, hit, rounds, n);
+    return 0;
+}
@@ -0,0 +1,410 @@
+#include "compiler.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "arena.h"
+#include "ast.h"
+#include "document.h"
+#include "front_end.h"
+#include "util.h"
+#include "option.h"
+#include "source.h"
+#include "type_table.h"
+
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+
+namespace cbc {
+
+static void dump_tokens(yyscan_t lexer, ostream& os)
+{
+    Option* option = (Option*)yyget_extra(lexer);
+    int c = 0;
+    char buf[128];
+    do {
+        parser::Parser::location_type loc;
+        parser::Parser::semantic_type val;
+        c = yylex(&val, &loc, lexer);
+        Token eof;
+        Token& tok = c ? val.as<Token>() : eof;
+        Location l(option->file_, tok.offset_);
+        // literals show their value, the others their text
+        const char* p = tok.image_;
+        int n = tok.length_;
+        if (c == parser::Parser::token::STRING ||
+                c == parser::Parser::token::CHARACTER) {
+            p = tok.value_.data();
+            n = tok.value_.size();
+        }
+        snprintf(buf, sizeof(buf), "token: %-15.*s at line: %d column: %d\n",
+            n, p ? p : "", l.lineno(), l.column());
+        os << buf;
+        if (c) {
+            val.destroy<Token>();
+        }
+    } while (c != 0);
+}
+
+static void report_constants(ConstantTable* constants, ostream& os)
+{
+    long bytes = 0;
+    for (auto* e : constants->entries()) {
+        bytes += e->size() + 1;
+    }
+    os << "constants: " << constants->entries().size() << " strings, "
+       << bytes << " bytes" << endl;
+}
+
+/* Resolves the types defined by the AST, imports included, in a table
+ * of their own, checks them and prints the layouts of the structs and
+ * unions of file. The type nodes of the AST are left alone, those of
+ * the imports are shared with the other files. Returns nonzero if the
+ * types are wrong.
+ */
+static int check_types(AST* ast, uint32_t file, ErrorHandler& errors,
+                       ostream& os)
+{
+    Declarations* decls = ast->declarations();
+    vector<TypeDefinition*> defs;
+    for (auto* n : decls->defstructs()) {
+        defs.push_back(n);
+    }
+    for (auto* n : decls->defunions()) {
+        defs.push_back(n);
+    }
+    for (auto* n : decls->typedefs()) {
+        defs.push_back(n);
+    }
+    // in source order, the declarations don't keep it
+    sort(defs.begin(), defs.end(), [](TypeDefinition* a, TypeDefinition* b) {
+        Location l = a->location(), r = b->location();
+        return l.file() != r.file() ? l.file() < r.file()
+                                    : l.offset() < r.offset();
+    });
+
+    unique_ptr<TypeTable> table(TypeTable::lp64());
+    // the member and real types, resolved once all names are known
+    vector<TypeNode*> nodes;
+    auto node = [&nodes](TypeRef* ref) {
+        nodes.push_back(new TypeNode(ref));
+        return nodes.back();
+    };
+    for (auto* def : defs) {
+        Type* t;
+        if (isa<TypedefNode>(def)) {
+            TypeNode* real = node(cast<TypedefNode>(def)->real_type_ref());
+            t = new UserType(def->name(), real, def->location());
+        } else {
+            vector<Slot*> slots;
+            for (auto* s : cast<CompositeTypeDefinition>(def)->members()) {
+                slots.push_back(new Slot(node(s->type_ref()), s->name()));
+            }
+            if (isa<StructNode>(def)) {
+                t = new StructType(def->name(), move(slots), def->location());
+            } else {
+                t = new UnionType(def->name(), move(slots), def->location());
+            }
+        }
+        try {
+            table->put(def->type_ref(), t);
+        } catch (string* e) {
+            errors.error(def->location(), *e);
+            delete e;
+        }
+        t->dec_ref();
+    }
+    for (auto* n : nodes) {
+        try {
+            n->set_type(table->get(n->type_ref()));
+        } catch (string* e) {
+            errors.error(n->location(), *e);
+            delete e;
+        }
+    }
+    if (!errors.error_occured()) {
+        table->semantic_check(&errors);
+    }
+    for (auto* n : nodes) {
+        n->dec_ref();
+    }
+    if (errors.error_occured()) {
+        return 1;
+    }
+
+    for (auto* def : defs) {
+        if (def->location().file() != file || isa<TypedefNode>(def)) {
+            continue;
+        }
+        auto* t = cast<CompositeType>(table->get(def->type_ref()));
+        os << t->to_string() << ": size " << t->size() << ", align "
+           << t->alignment() << endl;
+        for (auto* s : t->members()) {
+            os << "    " << s->name() << ": offset " << s->offset()
+               << ", size " << s->alloc_size() << endl;
+        }
+    }
+    return 0;
+}
+
+Compiler::Compiler() :
+    dump_ast_(false), dump_tokens_(false), check_types_(false),
+    mem_report_(false),
+    lazy_bodies_(false), syntax_only_(false), incremental_(false),
+    max_errors_(20), jobs_(1),
+    header_cache_(nullptr)
+{
+}
+
+Compiler::~Compiler()
+{
+    delete header_cache_;
+}
+
+bool Compiler::set_import_cache(const string& dir)
+{
+    if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        return false;
+    }
+    delete header_cache_;
+    header_cache_ = new HeaderCache(dir);
+    return true;
+}
+
+int Compiler::compile(const vector<string>& files, ostream& os)
+{
+    if (jobs_ > 1 && files.size() > 1) {
+        return compile_parallel(files, os);
+    }
+
+    int status = 0;
+    for (auto& file : files) {
+        if (compile_file(file, os) != 0) {
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int Compiler::compile_parallel(const vector<string>& files, ostream& os)
+{
+    size_t nfiles = files.size();
+    vector<string> outputs(nfiles);
+    vector<int> status(nfiles, 0);
+    vector<bool> done(nfiles, false);
+    atomic<size_t> next(0);
+    mutex mtx;
+    condition_variable cond;
+
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < nfiles) {
+            stringstream ss;
+            int res = compile_file(files[i], ss);
+            lock_guard<mutex> lock(mtx);
+            outputs[i] = ss.str();
+            status[i] = res;
+            done[i] = true;
+            cond.notify_one();
+        }
+    };
+
+    size_t nthreads = min((size_t)jobs_, nfiles);
+    vector<thread> threads;
+    for (size_t i = 0; i < nthreads; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    // print the results in argv order as soon as they are ready
+    int result = 0;
+    for (size_t i = 0; i < nfiles; ++i) {
+        string out;
+        {
+            unique_lock<mutex> lock(mtx);
+            cond.wait(lock, [&]() { return done[i]; });
+            out.swap(outputs[i]);
+        }
+        os << out;
+        os.flush();
+        if (status[i] != 0) {
+            result = 1;
+        }
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    return result;
+}
+
+int Compiler::compile_file(const string& path, ostream& os)
+{
+    SourceManager& sm = SourceManager::instance();
+    uint32_t file = sm.load(path);
+    if (!file) {
+        os << "can not open file " << path << endl;
+        return 1;
+    }
+    SourceFile* source = sm.file(file);
+    os << "processing file " << path << endl;
+
+    if (incremental_) {
+        string text(source->buffer(), source->size());
+        sm.remove(file);
+        return compile_document(path, text, os);
+    }
+
+    // everything built for this file is released at once with arena
+    Arena arena;
+    Arena::Scope scope(&arena);
+    unsigned long ops = ref_ops;
+
+    FrontEnd::Lease front_end;
+    Option& option = front_end->option();
+    option.src_ = path;
+    option.file_ = file;
+    option.text_ = source->buffer();
+    ConstantTable constants;
+    option.constants_ = &constants;
+    option.os_ = &os;
+    ErrorHandler errors("may", os);
+    errors.set_limit(max_errors_);
+    option.errors_ = &errors;
+    option.start_ = parser::Parser::token::COMPILE;
+    // a syntax check that skips the bodies wouldn't check much
+    option.lazy_ = lazy_bodies_ && !syntax_only_;
+    Loader loader;
+    loader.set_header_cache(header_cache_);
+    loader.set_output(&os);
+    option.loader_ = &loader;
+
+    front_end->scan(source);
+
+    int status = 0;
+    if (dump_tokens_) {
+        dump_tokens(front_end->scanner(), os);
+    } else if (syntax_only_) {
+        try {
+            auto start = chrono::steady_clock::now();
+            int res = front_end->recognize();
+            chrono::duration<double> secs = chrono::steady_clock::now() - start;
+            if (res != 0 || errors.error_occured()) {
+                status = 1;
+            }
+            // imports are parsed along, and in full
+            char buf[128];
+            snprintf(buf, sizeof(buf), "syntax: %zu bytes in %.6f sec, "
+                     "%.0f bytes/sec\n", source->size(), secs.count(),
+                     secs.count() > 0 ? source->size() / secs.count() : 0.0);
+            os << buf;
+        } catch (const string& e) {
+            os << e << endl;
+            status = 1;
+        } catch (...) {
+            status = 1;
+        }
+    } else {
+        try {
+            // the parser goes on after errors as far as it can
+            if (front_end->parse() == 0 && !errors.error_occured()) {
+                cbc::AST* ast = option.ast_;
+                if (dump_ast_) {
+                    // parse the skipped bodies, the dump is the same
+                    // as without --lazy-bodies
+                    for (auto* func : ast->defined_functions()) {
+                        func->body();
+                    }
+                    Dumper dumper(os);
+                    ast->dump(dumper);
+                }
+                if (check_types_ && check_types(ast, file, errors, os) != 0) {
+                    status = 1;
+                }
+                ast->dec_ref();
+            } else {
+                // nullptr if the parser gave up
+                if (option.ast_) {
+                    option.ast_->dec_ref();
+                }
+                status = 1;
+            }
+        } catch (const string& e) {
+            os << e << endl;
+            status = 1;
+        } catch (...) {
+            status = 1;
+        }
+    }
+
+    // nothing refers to the file after its AST is gone, but the
+    // skipped bodies, which remove it themselves
+    if (!option.bodies_) {
+        sm.remove(file);
+    }
+    option.bodies_->dec_ref();
+
+    if (mem_report_) {
+        os << "memory: " << arena.objects() << " objects, "
+           << arena.bytes() << " bytes in " << arena.chunks()
+           << " chunks" << endl;
+        os << "refcount: " << ref_ops - ops << " operations" << endl;
+        report_constants(&constants, os);
+    }
+    return status;
+}
+
+/* Parses the file as a Document, then takes each definition out and
+ * puts it back, the last first, so that the AST went through
+ * Document::edit() all over. The texts in between may not parse,
+ * their messages are dropped.
+ */
+int Compiler::compile_document(const string& path, const string& text,
+                               ostream& os)
+{
+    Document doc(path);
+    doc.set_header_cache(header_cache_);
+    doc.set_output(&os);
+    try {
+        if (!doc.parse(text)) {
+            return 1;
+        }
+        stringstream quiet;
+        doc.set_output(&quiet);
+        bool ok = true;
+        for (size_t i = doc.definitions(); i-- > 0; ) {
+            uint32_t begin = doc.definition_begin(i);
+            string def = doc.text().substr(begin,
+                                           doc.definition_end(i) - begin);
+            doc.edit(begin, def.size(), "");
+            ok = doc.edit(begin, 0, def);
+        }
+        doc.set_output(&os);
+        if (!ok) {
+            os << path << ": errors after editing it back" << endl;
+            return 1;
+        }
+    } catch (const string& e) {
+        os << e << endl;
+        return 1;
+    }
+    if (dump_ast_) {
+        Dumper dumper(os);
+        doc.ast()->dump(dumper);
+    }
+    if (mem_report_) {
+        report_constants(doc.ast()->constant_table(), os);
+    }
+    return 0;
+}
+
+} // namespace cbc
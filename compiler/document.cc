@@ -0,0 +1,414 @@
+#include "document.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "arena.h"
+#include "front_end.h"
+#include "option.h"
+#include "scan.h"
+#include "source.h"
+
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+#include "keyword.h"
+
+namespace cbc {
+
+struct Range {
+    uint32_t begin_;
+    uint32_t end_;
+    bool closed_;   // by its ';' or '}', else it runs to the end
+};
+
+// the first byte at or after p that isn't blank or in a comment
+static const char* skip_blanks(const char* p, const char* end)
+{
+    while (p < end) {
+        if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' ||
+                *p == '\f') {
+            ++p;
+        } else if (*p == '/' && end - p >= 2 && p[1] == '*') {
+            const char* q = find_comment_end(p + 2, end);
+            if (q == end) {
+                // left for the scanner to complain about
+                break;
+            }
+            p = q + 2;
+        } else if (*p == '/' && end - p >= 2 && p[1] == '/') {
+            const char* q = (const char*)memchr(p, '\n', end - p);
+            p = q ? q : end;
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+// Cuts the text from begin to end into top-level definitions without
+// scanning it for real: a definition ends with a ';' or a '}' that
+// isn't in braces, and a '}' followed by ';' (a struct or a union)
+// takes the ';' along. Only comments and literals need care.
+static vector<Range> split(const char* text, uint32_t begin, uint32_t end)
+{
+    vector<Range> ranges;
+    const char* e = text + end;
+    const char* p = skip_blanks(text + begin, e);
+    while (p < e) {
+        const char* start = p;
+        int depth = 0;
+        bool closed = true;
+        for (;;) {
+            char c = *p;
+            if (c == '"' || c == '\'') {
+                const char* q = find_quote(p + 1, e, c);
+                p = q == e ? e : q + 1;
+            } else {
+                ++p;
+            }
+            if (c == '{') {
+                ++depth;
+            } else if (c == '}' && depth > 0 && --depth == 0) {
+                const char* q = skip_blanks(p, e);
+                if (q < e && *q == ';') {
+                    p = q + 1;
+                }
+                break;
+            } else if (c == ';' && depth == 0) {
+                break;
+            }
+            const char* q = skip_blanks(p, e);
+            if (q == e) {
+                closed = false;
+                break;
+            }
+            p = q;
+        }
+        ranges.push_back(Range{(uint32_t)(start - text),
+                               (uint32_t)(p - text), closed});
+        p = skip_blanks(p, e);
+    }
+    return ranges;
+}
+
+static bool is_import(const string& text, const Range& r)
+{
+    size_t n = 0;
+    while (r.begin_ + n < r.end_ &&
+            (isalnum(text[r.begin_ + n]) || text[r.begin_ + n] == '_')) {
+        ++n;
+    }
+    return n > 0 &&
+        keyword_token(&text[r.begin_], n) == parser::Parser::token::IMPORT;
+}
+
+static int run_parser(FrontEnd* front_end, SourceFile* source)
+{
+    Option& option = front_end->option();
+    ErrorHandler errors("may", *option.os_);
+    option.errors_ = &errors;
+    front_end->scan(source);
+    int res = 1;
+    try {
+        res = front_end->parse();
+    } catch (const string& e) {
+        *option.os_ << e << endl;
+    } catch (...) {
+    }
+    if (res == 0 && errors.error_occured()) {
+        // recovered, but the AST misses what had errors
+        if (option.ast_) {
+            option.ast_->dec_ref();
+        }
+        if (option.own_decl_) {
+            option.own_decl_->dec_ref();
+            option.decl_->dec_ref();
+        }
+        res = 1;
+    }
+    return res;
+}
+
+Document::Document(const string& name) :
+    name_(name), file_(0), os_(&cerr), constants_(nullptr),
+    imports_end_(0), imports_file_(0), imports_(nullptr),
+    reparsed_(0), failed_(false), ast_(nullptr)
+{
+    loader_.set_output(os_);
+}
+
+Document::~Document()
+{
+    clear();
+    SourceManager::instance().remove(file_);
+}
+
+void Document::clear()
+{
+    if (ast_) {
+        ast_->dec_ref();
+        ast_ = nullptr;
+    }
+    for (auto& d : defs_) {
+        release(d);
+    }
+    defs_.clear();
+    if (imports_) {
+        imports_->dec_ref();
+        imports_ = nullptr;
+    }
+    SourceManager::instance().remove(imports_file_);
+    imports_file_ = 0;
+    imports_end_ = 0;
+    import_types_.clear();
+    delete constants_;
+    constants_ = nullptr;
+    failed_ = false;
+}
+
+void Document::release(Definition& d)
+{
+    if (d.decls_) {
+        d.decls_->dec_ref();
+        d.decls_ = nullptr;
+    }
+    SourceManager::instance().remove(d.file_);
+}
+
+bool Document::parse(const string& text)
+{
+    // the AST is kept across changes, it can't be in anybody's arena
+    Arena::Scope scope(nullptr);
+    SourceManager& sm = SourceManager::instance();
+
+    clear();
+    text_ = text;
+    if (file_) {
+        sm.update(file_, text_.data(), text_.size());
+    } else {
+        file_ = sm.add(name_, text_.data(), text_.size());
+    }
+    constants_ = new ConstantTable;
+
+    vector<Range> ranges = split(text_.data(), 0, text_.size());
+    size_t n = 0;
+    while (n < ranges.size() && is_import(text_, ranges[n])) {
+        ++n;
+    }
+    if (n > 0) {
+        imports_end_ = ranges[n - 1].end_;
+        failed_ = !parse_imports(imports_end_);
+    }
+
+    unordered_set<Symbol> names(import_types_);
+    for (size_t i = n; i < ranges.size(); ++i) {
+        defs_.push_back(parse_definition(ranges[i].begin_, ranges[i].end_,
+                                         ranges[i].closed_, names));
+    }
+    reparsed_ = defs_.size();
+    build_ast();
+    return ok();
+}
+
+bool Document::edit(uint32_t offset, uint32_t length, const string& text)
+{
+    if (offset > text_.size() || length > text_.size() - offset) {
+        throw string("edit out of range in ") + name_;
+    }
+    if (!file_ || failed_ || offset < imports_end_) {
+        string updated(text_);
+        updated.replace(offset, length, text);
+        return parse(updated);
+    }
+
+    Arena::Scope scope(nullptr);
+    SourceManager& sm = SourceManager::instance();
+    uint32_t old_size = text_.size();
+    text_.replace(offset, length, text);
+    sm.update(file_, text_.data(), text_.size());
+    int64_t delta = (int64_t)text.size() - length;
+
+    // the definitions the edit touches, and the text around them
+    // down to the ones it leaves alone
+    size_t first = 0;
+    while (first < defs_.size() && defs_[first].end_ < offset) {
+        ++first;
+    }
+    if (first > 0 && !defs_[first - 1].closed_) {
+        --first;
+    }
+    size_t last = first;
+    while (last < defs_.size() && defs_[last].begin_ <= offset + length) {
+        ++last;
+    }
+    uint32_t begin = first > 0 ? defs_[first - 1].end_ : imports_end_;
+    uint32_t end = (last < defs_.size() ? defs_[last].begin_ : old_size)
+        + delta;
+
+    vector<Range> ranges = split(text_.data(), begin, end);
+    while (!ranges.empty() && !ranges.back().closed_ &&
+            last < defs_.size()) {
+        // a brace is left open, the next definition is part of it
+        ++last;
+        end = (last < defs_.size() ? defs_[last].begin_ : old_size) + delta;
+        ranges = split(text_.data(), begin, end);
+    }
+    for (auto& r : ranges) {
+        if (is_import(text_, r)) {
+            // only the full parse knows whether it may be there
+            return parse(string(text_));
+        }
+    }
+
+    unordered_set<Symbol> names(import_types_);
+    for (size_t i = 0; i < first; ++i) {
+        names.insert(defs_[i].typedefs_.begin(), defs_[i].typedefs_.end());
+    }
+    vector<Definition> fresh;
+    for (auto& r : ranges) {
+        fresh.push_back(parse_definition(r.begin_, r.end_, r.closed_, names));
+    }
+
+    vector<Symbol> old_types;
+    for (size_t i = first; i < last; ++i) {
+        old_types.insert(old_types.end(), defs_[i].typedefs_.begin(),
+                         defs_[i].typedefs_.end());
+    }
+    vector<Symbol> new_types;
+    for (auto& d : fresh) {
+        new_types.insert(new_types.end(), d.typedefs_.begin(),
+                         d.typedefs_.end());
+    }
+    sort(old_types.begin(), old_types.end());
+    sort(new_types.begin(), new_types.end());
+
+    if (old_types != new_types && last < defs_.size()) {
+        // what follows may scan differently now
+        for (auto& r : split(text_.data(), end, text_.size())) {
+            fresh.push_back(parse_definition(r.begin_, r.end_, r.closed_,
+                                             names));
+        }
+        last = defs_.size();
+    } else {
+        for (size_t i = last; i < defs_.size(); ++i) {
+            defs_[i].begin_ += delta;
+            defs_[i].end_ += delta;
+            sm.move_segment(defs_[i].file_, defs_[i].begin_);
+        }
+    }
+
+    for (size_t i = first; i < last; ++i) {
+        release(defs_[i]);
+    }
+    defs_.erase(defs_.begin() + first, defs_.begin() + last);
+    defs_.insert(defs_.begin() + first, fresh.begin(), fresh.end());
+    reparsed_ = fresh.size();
+    build_ast();
+    // the literals of the released definitions go with the old AST
+    constants_->collect();
+    return ok();
+}
+
+bool Document::ok()
+{
+    if (failed_) {
+        return false;
+    }
+    for (auto& d : defs_) {
+        if (!d.decls_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Document::parse_imports(uint32_t end)
+{
+    SourceManager& sm = SourceManager::instance();
+    imports_file_ = sm.add_segment(file_, 0, end);
+
+    FrontEnd::Lease front_end;
+    Option& option = front_end->option();
+    option.src_ = name_;
+    option.file_ = imports_file_;
+    option.text_ = sm.file(imports_file_)->buffer();
+    option.os_ = os_;
+    option.start_ = parser::Parser::token::DECLARE;
+    option.loader_ = &loader_;
+    option.constants_ = constants_;
+    if (run_parser(front_end.get(), sm.file(imports_file_)) != 0) {
+        return false;
+    }
+    // the imported declarations are all there is
+    imports_ = option.decl_;
+    option.own_decl_->dec_ref();
+    import_types_.swap(option.typename_);
+    return true;
+}
+
+Document::Definition Document::parse_definition(uint32_t begin, uint32_t end,
+        bool closed, unordered_set<Symbol>& names)
+{
+    SourceManager& sm = SourceManager::instance();
+    Definition d;
+    d.begin_ = begin;
+    d.end_ = end;
+    d.closed_ = closed;
+    d.file_ = sm.add_segment(file_, begin, end - begin);
+    d.decls_ = nullptr;
+
+    FrontEnd::Lease front_end;
+    Option& option = front_end->option();
+    option.src_ = name_;
+    option.file_ = d.file_;
+    option.text_ = sm.file(d.file_)->buffer();
+    option.os_ = os_;
+    option.start_ = parser::Parser::token::COMPILE;
+    option.loader_ = &loader_;
+    option.constants_ = constants_;
+    // Lend the names to the scanner, a typedef adds its own. Imports
+    // after the definitions don't parse, and mustn't leave the names
+    // they bring in behind.
+    bool lend = !is_import(text_, Range{begin, end, closed});
+    if (lend) {
+        option.typename_.swap(names);
+    }
+    int res = run_parser(front_end.get(), sm.file(d.file_));
+    if (lend) {
+        option.typename_.swap(names);
+    }
+
+    if (res == 0) {
+        d.decls_ = option.ast_->declarations();
+        d.decls_->inc_ref();
+        option.ast_->dec_ref();
+        for (auto* t : d.decls_->typedefs()) {
+            d.typedefs_.push_back(t->name());
+        }
+    }
+    return d;
+}
+
+void Document::build_ast()
+{
+    if (ast_) {
+        ast_->dec_ref();
+    }
+    auto* decls = new Declarations;
+    if (imports_) {
+        decls->add(imports_);
+    }
+    for (auto& d : defs_) {
+        if (d.decls_) {
+            decls->add(d.decls_);
+        }
+    }
+    // at the first token, like the AST of a whole file
+    const char* text = text_.data();
+    uint32_t begin = imports_end_ > 0 || defs_.empty() ?
+        skip_blanks(text, text + text_.size()) - text : defs_[0].begin_;
+    ast_ = new AST(Location(file_, begin), decls, constants_);
+    decls->dec_ref();
+}
+
+} // namespace cbc
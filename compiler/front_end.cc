@@ -0,0 +1,88 @@
+#include "front_end.h"
+
+#include <vector>
+
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+#include "parser/recognizer.hh"
+
+namespace cbc {
+
+// the FrontEnds not in use on this thread
+struct FrontEndPool {
+    ~FrontEndPool() {
+        for (auto* front_end : free_) {
+            delete front_end;
+        }
+    }
+
+    vector<FrontEnd*> free_;
+};
+
+static thread_local FrontEndPool pool;
+
+FrontEnd* FrontEnd::acquire()
+{
+    if (pool.free_.empty()) {
+        return new FrontEnd;
+    }
+    FrontEnd* front_end = pool.free_.back();
+    pool.free_.pop_back();
+    return front_end;
+}
+
+void FrontEnd::release(FrontEnd* front_end)
+{
+    front_end->reset();
+    pool.free_.push_back(front_end);
+}
+
+FrontEnd::FrontEnd() : buffer_(nullptr), recognizer_(nullptr)
+{
+    yyscan_t lexer;
+    yylex_init(&lexer);
+    yyset_extra(&option_, lexer);
+    scanner_ = lexer;
+    parser_ = new parser::Parser(lexer);
+}
+
+FrontEnd::~FrontEnd()
+{
+    reset();
+    delete recognizer_;
+    delete parser_;
+    yylex_destroy(scanner_);
+}
+
+void FrontEnd::reset()
+{
+    if (buffer_) {
+        yy_delete_buffer((YY_BUFFER_STATE)buffer_, scanner_);
+        buffer_ = nullptr;
+    }
+    option_.reset();
+}
+
+void FrontEnd::scan(SourceFile* source)
+{
+    if (buffer_) {
+        yy_delete_buffer((YY_BUFFER_STATE)buffer_, scanner_);
+    }
+    buffer_ = yy_scan_buffer(source->buffer(), source->buffer_size(),
+                             scanner_);
+}
+
+int FrontEnd::parse()
+{
+    return parser_->parse();
+}
+
+int FrontEnd::recognize()
+{
+    if (!recognizer_) {
+        recognizer_ = new parser::Recognizer(scanner_);
+    }
+    return recognizer_->parse();
+}
+
+} // namespace cbc
@@ -0,0 +1,290 @@
+#include "server.h"
+
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <streambuf>
+
+#include "loader.h"
+#include "symbol.h"
+
+namespace cbc {
+
+// A request is a handful of options and file names, anything beyond
+// these limits comes from a broken client.
+static const uint32_t kMaxArgs = 4096;
+static const uint32_t kMaxArgSize = 64 * 1024;
+
+// Each message is a one byte kind followed by a 32-bit length, or the
+// exit status for kExit, and the payload.
+enum MessageKind {
+    kOutput = 'o',
+    kExit = 'x',
+};
+
+static bool write_all(int fd, const char* p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return false;
+        }
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+static bool read_all(int fd, char* p, size_t n)
+{
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+static bool write_message(int fd, char kind, uint32_t n, const char* data)
+{
+    char head[5];
+    head[0] = kind;
+    memcpy(head + 1, &n, sizeof(n));
+    return write_all(fd, head, sizeof(head)) &&
+           (kind == kExit || write_all(fd, data, n));
+}
+
+static bool write_string(int fd, const string& s)
+{
+    uint32_t n = s.size();
+    return write_all(fd, (const char*)&n, sizeof(n)) &&
+           write_all(fd, s.data(), n);
+}
+
+static bool read_string(int fd, string& s)
+{
+    uint32_t n;
+    if (!read_all(fd, (char*)&n, sizeof(n)) || n > kMaxArgSize) {
+        return false;
+    }
+    s.resize(n);
+    return read_all(fd, &s[0], n);
+}
+
+static int connect_to(const string& path)
+{
+    struct sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Sends everything written to it to the client as kOutput messages.
+ * Write errors are ignored, the client may have gone away.
+ */
+class SocketBuf : public streambuf {
+public:
+    SocketBuf(int fd) : fd_(fd) { setp(buf_, buf_ + sizeof(buf_)); }
+
+protected:
+    int overflow(int c) {
+        sync();
+        if (c != EOF) {
+            *pptr() = c;
+            pbump(1);
+        }
+        return c == EOF ? 0 : c;
+    }
+
+    int sync() {
+        if (pptr() > pbase()) {
+            write_message(fd_, kOutput, pptr() - pbase(), pbase());
+            setp(buf_, buf_ + sizeof(buf_));
+        }
+        return 0;
+    }
+
+protected:
+    int fd_;
+    char buf_[4096];
+};
+
+Server::Server(const string& path, Handler handler) :
+    path_(path), handler_(handler), fd_(-1)
+{
+    // requests change the directory, see serve()
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd))) {
+        dir_ = cwd;
+        if (!path_.empty() && path_[0] != '/') {
+            path_ = dir_ + "/" + path_;
+        }
+    }
+}
+
+Server::~Server()
+{
+    if (fd_ >= 0) {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+}
+
+int Server::run()
+{
+    struct sockaddr_un addr;
+    if (path_.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path_.c_str());
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        return 1;
+    }
+    unlink(path_.c_str());   // left over by a server that was killed
+    if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(fd_, 16) < 0) {
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    ModuleRegistry::instance().set_check_mtime(true);
+
+    for (;;) {
+        int fd = accept(fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return 1;
+        }
+        serve(fd);
+        close(fd);
+        // back where the server was started, a restart runs its own
+        // command line there
+        if (!dir_.empty() && chdir(dir_.c_str()) < 0) {
+            return 1;
+        }
+        // symbol ids are never freed; start afresh while a request
+        // still has plenty of room
+        if (Symbol::count() > Symbol::capacity() / 4 * 3) {
+            return 0;
+        }
+    }
+}
+
+void Server::serve(int fd)
+{
+    uint32_t n;
+    if (!read_all(fd, (char*)&n, sizeof(n)) || n == 0 || n > kMaxArgs) {
+        return;
+    }
+    vector<string> args(n);
+    for (auto& arg : args) {
+        if (!read_string(fd, arg)) {
+            return;
+        }
+    }
+    string cwd = args[0];
+    args.erase(args.begin());
+
+    SocketBuf buf(fd);
+    ostream os(&buf);
+    int status = 1;
+    if (chdir(cwd.c_str()) < 0) {
+        os << "can not change directory to " << cwd << ": "
+           << strerror(errno) << endl;
+    } else {
+        // nothing is being compiled between two requests
+        ModuleRegistry::instance().collect();
+        try {
+            status = handler_(args, os);
+        } catch (...) {
+        }
+    }
+    os.flush();
+    write_message(fd, kExit, status, nullptr);
+}
+
+int Server::forward(const string& path, const vector<string>& args,
+                    ostream& os)
+{
+    int fd = connect_to(path);
+    if (fd < 0) {
+        return -1;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        close(fd);
+        return -1;
+    }
+
+    uint32_t n = args.size() + 1;
+    bool ok = write_all(fd, (const char*)&n, sizeof(n)) &&
+              write_string(fd, cwd);
+    for (auto& arg : args) {
+        ok = ok && write_string(fd, arg);
+    }
+
+    int status = -1;
+    string data;
+    while (ok) {
+        char head[5];
+        if (!read_all(fd, head, sizeof(head))) {
+            break;
+        }
+        memcpy(&n, head + 1, sizeof(n));
+        if (head[0] == kExit) {
+            status = n;
+            break;
+        }
+        data.resize(n);
+        if (!read_all(fd, &data[0], n)) {
+            break;
+        }
+        os.write(data.data(), n);
+    }
+    close(fd);
+
+    if (status < 0) {
+        os << "lost connection to server " << path << endl;
+        return 1;
+    }
+    return status;
+}
+
+} // namespace cbc
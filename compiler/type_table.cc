@@ -1,25 +1,42 @@
 #include "type_table.h"
+
+#include <algorithm>
+#include <unordered_set>
+
 #include "node.h"
 
 namespace cbc {
 
 TypeTable::TypeTable(int int_size, int long_size, int ptr_size) :
-        int_size_(int_size), long_size_(long_size), pointer_size_(ptr_size)
+        int_size_(int_size), long_size_(long_size), pointer_size_(ptr_size),
+        void_type_(nullptr), signed_char_(nullptr), signed_short_(nullptr),
+        signed_int_(nullptr), signed_long_(nullptr), unsigned_char_(nullptr),
+        unsigned_short_(nullptr), unsigned_int_(nullptr),
+        unsigned_long_(nullptr)
 {   
 }
 
 TypeTable* TypeTable::new_table(int charsize, int shortsize, int intsize, int longsize, int ptrsize)
 {
     TypeTable* table = new TypeTable(intsize, longsize, ptrsize);
-    table->put(new VoidTypeRef(), new VoidType());
-    table->put(IntegerTypeRef::char_ref(), new IntegerType(charsize, true, "char"));
-    table->put(IntegerTypeRef::short_ref(), new IntegerType(shortsize, true, "short"));
-    table->put(IntegerTypeRef::int_ref(), new IntegerType(intsize, true, "int"));
-    table->put(IntegerTypeRef::long_ref(), new IntegerType(longsize, true, "long"));
-    table->put(IntegerTypeRef::uchar_ref(), new IntegerType(charsize, false, "unsigned char"));
-    table->put(IntegerTypeRef::ushort_ref(), new IntegerType(shortsize, false, "unsigned short"));
-    table->put(IntegerTypeRef::uint_ref(), new IntegerType(intsize, false, "unsigned int"));
-    table->put(IntegerTypeRef::ulong_ref(), new IntegerType(longsize, false, "unsigned long"));
+    table->void_type_ = new VoidType();
+    table->signed_char_ = new IntegerType(charsize, true, "char");
+    table->signed_short_ = new IntegerType(shortsize, true, "short");
+    table->signed_int_ = new IntegerType(intsize, true, "int");
+    table->signed_long_ = new IntegerType(longsize, true, "long");
+    table->unsigned_char_ = new IntegerType(charsize, false, "unsigned char");
+    table->unsigned_short_ = new IntegerType(shortsize, false, "unsigned short");
+    table->unsigned_int_ = new IntegerType(intsize, false, "unsigned int");
+    table->unsigned_long_ = new IntegerType(longsize, false, "unsigned long");
+    table->put(new VoidTypeRef(), table->void_type_);
+    table->put(IntegerTypeRef::char_ref(), table->signed_char_);
+    table->put(IntegerTypeRef::short_ref(), table->signed_short_);
+    table->put(IntegerTypeRef::int_ref(), table->signed_int_);
+    table->put(IntegerTypeRef::long_ref(), table->signed_long_);
+    table->put(IntegerTypeRef::uchar_ref(), table->unsigned_char_);
+    table->put(IntegerTypeRef::ushort_ref(), table->unsigned_short_);
+    table->put(IntegerTypeRef::uint_ref(), table->unsigned_int_);
+    table->put(IntegerTypeRef::ulong_ref(), table->unsigned_long_);
     return table;
 }
 
@@ -27,12 +44,28 @@ TypeTable::~TypeTable()
 {
     for (auto p : table_) {
         int n = 1;
-        if (p.first->instanceof<VoidTypeRef>() || p.first->instanceof<IntegerTypeRef>())
+        if (p.first->kind() == TypeRef::kVoid ||
+                p.first->kind() == TypeRef::kInteger)
             n = 2;
 
         p.first->dec_ref(n);
         p.second->dec_ref(n);
     }
+    for (auto& p : pointers_) {
+        p.second->dec_ref();
+    }
+    for (auto& p : arrays_) {
+        p.second->dec_ref();
+    }
+    for (auto& p : functions_) {
+        p.second->dec_ref();
+    }
+    for (auto* r : {&compatible_, &castable_}) {
+        for (auto& p : *r) {
+            p.first.first->dec_ref();
+            p.first.second->dec_ref();
+        }
+    }
 }
 
 bool TypeTable::is_defined(TypeRef* ref)
@@ -44,39 +77,40 @@ Type* TypeTable::get(TypeRef* ref)
 {
     auto it = table_.find(ref);
     if (it != table_.end()) {
-        it->second->inc_ref();
         return it->second;
     }
 
-    if (ref->instanceof<UserTypeRef>()) {
+    RefPtr<Type> t;
+    switch (ref->kind()) {
+    case TypeRef::kUser:
         // If unregistered UserType is used in program, it causes
         // parse error instead of semantic error.  So we do not
         // need to handle this error.
-        UserTypeRef* uref = (UserTypeRef*)ref;
-        throw new string("undefined type: " + uref->name());
-
-    } else if (ref->instanceof<PointerTypeRef>()) {
-        PointerTypeRef* pref = (PointerTypeRef*)ref;
-        Type* t = new PointerType(pointer_size_, get(pref->base_type()));
-        ref->inc_ref();
-        table_[pref] = t;
-        return t;
-
-    } else if (ref->instanceof<ArrayTypeRef>()) {
-        ArrayTypeRef* aref = (ArrayTypeRef*)ref;
-        Type* t = new ArrayType(get(aref->base_type()), aref->length(), pointer_size_);
-        ref->inc_ref();
-        table_[aref] = t;
-        return t;
+        throw new string("undefined type: " + cast<UserTypeRef>(ref)->name());
 
-    } else if (ref->instanceof<FunctionTypeRef>()) {
-        FunctionTypeRef* fref = (FunctionTypeRef*)ref;
-        Type* t = new FunctionType(get(fref->return_type()), fref->params()->intern_types(this));
-        ref->inc_ref();
-        table_[fref] = t;
-        return t;
+    case TypeRef::kPointer: {
+        PointerTypeRef* pref = cast<PointerTypeRef>(ref);
+        t = pointer_to(get(pref->base_type()));
+        break;
+    }
+    case TypeRef::kArray: {
+        ArrayTypeRef* aref = cast<ArrayTypeRef>(ref);
+        t = array_of(get(aref->base_type()), aref->length());
+        break;
+    }
+    case TypeRef::kFunction: {
+        FunctionTypeRef* fref = cast<FunctionTypeRef>(ref);
+        auto params = RefPtr<ParamTypes>::adopt(fref->params()->intern_types(this));
+        t = function_of(get(fref->return_type()), params.get());
+        break;
     }
-    throw new string("unregistered type: " + ref->to_string());
+    default:
+        throw new string("unregistered type: " + ref->to_string());
+    }
+    // another ref of the same type finds it directly next time
+    ref->inc_ref();
+    table_[ref] = t.get();
+    return t.release();
 }
 
 void TypeTable::put(TypeRef* ref, Type* t)
@@ -94,180 +128,269 @@ Type* TypeTable::get_param_type(TypeRef* ref)
 {
     Type* t = get(ref);
     if (t->is_array()) {
-        t->dec_ref();
-        return pointer_to(t->base_type());
+        // pointers_ keeps it
+        return pointer_to(t->base_type()).get();
     }
     return t;
 }
 
-PointerType* TypeTable::pointer_to(Type* base_type)
-{
-    return new PointerType(pointer_size_, base_type);
-}
-
-string TypeTable::ptr_diff_type_name()
+RefPtr<PointerType> TypeTable::pointer_to(Type* base_type)
 {
-    auto *sl = signed_long();
-    if (sl->size() == pointer_size_) {
-        sl->dec_ref();
-        return "long";
-    }
-    sl->dec_ref();
-
-    sl = signed_int();
-    if (sl->size() == pointer_size_) {
-        sl->dec_ref();
-        return "int";
+    PointerType*& t = pointers_[base_type];
+    if (!t) {
+        t = new PointerType(pointer_size_, base_type);
     }
-    sl->dec_ref();
-
-    sl = signed_short();
-    if (sl->size() == pointer_size_) {
-        sl->dec_ref();
-        return "short";
-    }
-    sl->dec_ref();
-    throw string("must not happen: integer.size != pointer.size");
+    return RefPtr<PointerType>(t);
 }
 
-vector<Type*> TypeTable::types()
+RefPtr<ArrayType> TypeTable::array_of(Type* base_type, long length)
 {
-    vector<Type*> v;
-    for (auto& p : table_) {
-        p.second->inc_ref();
-        v.push_back(p.second);
+    ArrayType*& t = arrays_[make_pair(base_type, length)];
+    if (!t) {
+        t = new ArrayType(base_type, length, pointer_size_);
     }
-    return v;
-}
-    
-VoidType* TypeTable::void_type()
-{
-    auto* ref = new VoidTypeRef();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (VoidType*)tp;
-}
-
-IntegerType* TypeTable::signed_char()
-{
-    auto* ref = IntegerTypeRef::char_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    return RefPtr<ArrayType>(t);
 }
 
-IntegerType* TypeTable::signed_short()
+RefPtr<FunctionType> TypeTable::function_of(Type* return_type,
+                                            ParamTypes* params)
 {
-    auto* ref = IntegerTypeRef::short_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
-}
-
-IntegerType* TypeTable::signed_int()
-{
-    auto* ref = IntegerTypeRef::int_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    vector<Type*> key;
+    key.reserve(params->param_descs_.size() + 2);
+    key.push_back(return_type);
+    key.insert(key.end(), params->param_descs_.begin(),
+               params->param_descs_.end());
+    if (params->is_vararg()) {
+        key.push_back(nullptr);
+    }
+    FunctionType*& t = functions_[move(key)];
+    if (!t) {
+        t = new FunctionType(return_type, params);
+    }
+    return RefPtr<FunctionType>(t);
 }
 
-IntegerType* TypeTable::signed_long()
+// looks the pair up in r, or asks t and remembers the answer
+template<typename Relation>
+static bool relate(Relation& r, Type* t, Type* other,
+                   bool (Type::*method)(Type*))
 {
-    auto* ref = IntegerTypeRef::long_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    auto key = make_pair(t, other);
+    auto it = r.find(key);
+    if (it != r.end()) {
+        return it->second;
+    }
+    bool res = (t->*method)(other);
+    t->inc_ref();
+    other->inc_ref();
+    r[key] = res;
+    return res;
 }
 
-IntegerType* TypeTable::unsigned_char()
+bool TypeTable::is_compatible(Type* t, Type* other)
 {
-    auto* ref = IntegerTypeRef::uchar_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    return relate(compatible_, t, other, &Type::is_compatible);
 }
 
-IntegerType* TypeTable::unsigned_short()
+bool TypeTable::is_castable_to(Type* t, Type* other)
 {
-    auto* ref = IntegerTypeRef::ushort_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    return relate(castable_, t, other, &Type::is_castable_to);
 }
 
-IntegerType* TypeTable::unsigned_int()
+string TypeTable::ptr_diff_type_name()
 {
-    auto* ref = IntegerTypeRef::uint_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    if (long_size_ == pointer_size_) {
+        return "long";
+    }
+    if (int_size_ == pointer_size_) {
+        return "int";
+    }
+    if (signed_short()->size() == pointer_size_) {
+        return "short";
+    }
+    throw string("must not happen: integer.size != pointer.size");
 }
 
-IntegerType* TypeTable::unsigned_long()
+vector<Type*> TypeTable::types()
 {
-    auto* ref = IntegerTypeRef::ulong_ref();
-    auto* tp = get(ref);
-    tp->inc_ref();
-    ref->dec_ref();
-    return (IntegerType*)tp;
+    vector<Type*> v;
+    for (auto& p : table_) {
+        p.second->inc_ref();
+        v.push_back(p.second);
+    }
+    return v;
 }
-
+    
 void TypeTable::semantic_check(ErrorHandler* h)
 {
-    for (Type* t : types()) {
-        // We can safely use "instanceof" instead of isXXXX() here,
+    // each type once, however many refs name it; the table holds them
+    unordered_set<Type*> seen;
+    vector<Type*> types;
+    for (auto& p : table_) {
+        if (seen.insert(p.second).second) {
+            types.push_back(p.second);
+        }
+    }
+
+    for (Type* t : types) {
+        // We can safely use isa<>() instead of isXXXX() here,
         // because the type refered from UserType must be also
         // kept in this table.
-        if (t->instanceof<CompositeType>()) {
-            check_void_members((CompositeType*)t, h);
-            check_duplicated_members((CompositeType*)t, h);
-        } else if (t->instanceof<ArrayType>()) {
-            check_void_members((ArrayType*)t, h);
+        if (isa<CompositeType>(t)) {
+            check_void_members(cast<CompositeType>(t), h);
+            check_duplicated_members(cast<CompositeType>(t), h);
+        } else if (isa<ArrayType>(t)) {
+            check_void_members(cast<ArrayType>(t), h);
+        }
+    }
+    check_recursive_definitions(types, h);
+    if (h->error_occured()) {
+        return;
+    }
+    // the layouts are fixed from now on, work them out once
+    for (Type* t : types) {
+        if (isa<CompositeType>(t)) {
+            cast<CompositeType>(t)->layout();
         }
-
-        check_recursive_definition(t, h);
-        t->dec_ref();
     }
 }
 
 void TypeTable::check_void_members(CompositeType* t, ErrorHandler* h)
 {
     for (Slot* s : t->members()) {
-        auto tp = s->type();
-        if (tp->is_void()) {
+        if (s->type()->is_void()) {
             h->error(t->location(), "struct and union cannot contain void");
         }
-        tp->dec_ref();
-        s->dec_ref();
     }
 }
 
 void TypeTable::check_void_members(ArrayType* t, ErrorHandler* h)
 {
-    auto base = t->base_type();
-    if (base->is_void()) {
+    if (t->base_type()->is_void()) {
         h->error("array cannot contain void");
     }
-    base->dec_ref();
 }
 
 void TypeTable::check_duplicated_members(CompositeType* t, ErrorHandler* h)
 {
-
+    unordered_set<Symbol> names;
+    names.reserve(t->members().size());
+    for (Slot* s : t->members()) {
+        if (!names.insert(s->name()).second) {
+            h->error(t->location(), "duplicated member: " + s->name());
+        }
+    }
 }
 
-void TypeTable::check_recursive_definition(Type* t, ErrorHandler* h)
+// the types t holds by value, which must be complete before t is;
+// a pointer or a function breaks the chain
+static void value_edges(Type* t, vector<Type*>& edges)
 {
+    switch (t->kind()) {
+    case Type::kStruct:
+    case Type::kUnion:
+        for (Slot* s : cast<CompositeType>(t)->members()) {
+            edges.push_back(s->type());
+        }
+        break;
+    case Type::kArray:
+        edges.push_back(cast<ArrayType>(t)->base_type());
+        break;
+    case Type::kUser:
+        edges.push_back(cast<UserType>(t)->real_type());
+        break;
+    default:
+        break;
+    }
+}
 
-} 
+/* The strongly connected components of the by-value graph, found in
+ * one pass (Tarjan). A component of more than one type, or a type
+ * that holds itself, is a cycle. The walk keeps its own stack, as a
+ * chain of definitions can be long.
+ */
+void TypeTable::check_recursive_definitions(const vector<Type*>& types,
+                                            ErrorHandler* h)
+{
+    struct Visit {
+        size_t index_;
+        size_t low_;
+        bool on_stack_;
+    };
+    struct Frame {
+        Type* type_;
+        vector<Type*> edges_;
+        size_t next_;
+    };
+    unordered_map<Type*, Visit> visits;
+    vector<Type*> component;
+    vector<Frame> frames;
+
+    auto enter = [&](Type* t) {
+        size_t n = visits.size();
+        visits[t] = Visit{n, n, true};
+        component.push_back(t);
+        frames.push_back(Frame{t, vector<Type*>(), 0});
+        value_edges(t, frames.back().edges_);
+    };
+
+    for (Type* root : types) {
+        if (visits.count(root)) {
+            continue;
+        }
+        enter(root);
+        while (!frames.empty()) {
+            Frame& f = frames.back();
+            if (f.next_ < f.edges_.size()) {
+                Type* u = f.edges_[f.next_++];
+                auto it = visits.find(u);
+                if (it == visits.end()) {
+                    enter(u);
+                } else if (it->second.on_stack_) {
+                    Visit& v = visits[f.type_];
+                    v.low_ = min(v.low_, it->second.index_);
+                }
+                continue;
+            }
+
+            Type* t = f.type_;
+            bool holds_itself =
+                find(f.edges_.begin(), f.edges_.end(), t) != f.edges_.end();
+            frames.pop_back();
+            Visit& v = visits[t];
+            if (!frames.empty()) {
+                Visit& parent = visits[frames.back().type_];
+                parent.low_ = min(parent.low_, v.low_);
+            }
+            if (v.low_ != v.index_) {
+                continue;
+            }
+
+            // t is the first of its component, which is above it
+            vector<Type*> cycle;
+            Type* c;
+            do {
+                c = component.back();
+                component.pop_back();
+                visits[c].on_stack_ = false;
+                cycle.push_back(c);
+            } while (c != t);
+            reverse(cycle.begin(), cycle.end());
+            if (cycle.size() == 1 && !holds_itself) {
+                continue;
+            }
+            string names;
+            NamedType* named = nullptr;
+            for (Type* c : cycle) {
+                names += (names.empty() ? "" : ", ") + c->to_string();
+                if (!named && isa<NamedType>(c)) {
+                    named = cast<NamedType>(c);
+                }
+            }
+            // only a named type can close a cycle
+            h->error(named->location(), "recursive type definition: " + names);
+        }
+    }
+}
 
 }  // namespace cbc
\ No newline at end of file
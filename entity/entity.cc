@@ -3,7 +3,7 @@
 
 namespace cbc {
 
-Entity::Entity(bool priv, TypeNode* type, const string& name)
+Entity::Entity(bool priv, TypeNode* type, Symbol name)
     : priv_(priv), tnode_(type), name_(name)
 {
     tnode_->inc_ref();
@@ -27,7 +27,6 @@ void Entity::dump(Dumper& dumper)
 
 Type* Entity::type() 
 { 
-    tnode_->type()->inc_ref();
     return tnode_->type(); 
 }
     
@@ -41,7 +40,7 @@ Location Entity::location()
     return tnode_->location(); 
 }
 
-Constant::Constant(TypeNode* type, const string& name, ExprNode* value)
+Constant::Constant(TypeNode* type, Symbol name, ExprNode* value)
     : Entity(true, type, name), value_(value)
 {
     value_->inc_ref();
@@ -52,11 +51,88 @@ Constant::~Constant()
     value_->dec_ref();
 }
 
-ConstantEntry::ConstantEntry(const string& val) :
-    val_(val)
+ConstantEntry::ConstantEntry(const string& val, long index) :
+    val_(val), index_(index)
 {
 }
 
+// FNV-1a
+static uint32_t hash_value(const string& val)
+{
+    uint32_t h = 2166136261u;
+    for (unsigned char c : val) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+ConstantTable::ConstantTable() : slots_(64, 0)
+{
+}
+
+ConstantTable::~ConstantTable()
+{
+    for (auto* e : entries_) {
+        e->dec_ref();
+    }
+}
+
+ConstantEntry* ConstantTable::intern(const string& val)
+{
+    uint32_t h = hash_value(val);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = h & mask; ; i = (i + 1) & mask) {
+        uint32_t n = slots_[i];
+        if (n == 0) {
+            auto* e = new ConstantEntry(val, entries_.size());
+            entries_.push_back(e);
+            hashes_.push_back(h);
+            slots_[i] = entries_.size();
+            // keep the slots at most half full
+            if (entries_.size() * 2 > slots_.size()) {
+                rehash(slots_.size() * 2);
+            }
+            return e;
+        }
+        if (hashes_[n - 1] == h && entries_[n - 1]->value() == val) {
+            return entries_[n - 1];
+        }
+    }
+}
+
+void ConstantTable::collect()
+{
+    size_t n = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        ConstantEntry* e = entries_[i];
+        if (e->get_ref() == 1) {
+            e->dec_ref();
+            continue;
+        }
+        e->index_ = n;
+        entries_[n] = e;
+        hashes_[n] = hashes_[i];
+        ++n;
+    }
+    entries_.resize(n);
+    hashes_.resize(n);
+    rehash(slots_.size());
+}
+
+void ConstantTable::rehash(size_t size)
+{
+    slots_.assign(size, 0);
+    size_t mask = slots_.size() - 1;
+    for (size_t n = 0; n < entries_.size(); ++n) {
+        size_t i = hashes_[n] & mask;
+        while (slots_[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = n + 1;
+    }
+}
+
 void Constant::dump_node(Dumper& dumper)
 {
     dumper.print_member("name", name_);
@@ -64,13 +140,13 @@ void Constant::dump_node(Dumper& dumper)
     dumper.print_member("value", value_);
 }
 
-Variable::Variable(bool priv, TypeNode* type, const string& name) :
+Variable::Variable(bool priv, TypeNode* type, Symbol name) :
     Entity(priv, type, name)
 {
 }
 
 DefinedVariable::DefinedVariable(bool priv, TypeNode* type,
-        const string& name, ExprNode* init) :
+        Symbol name, ExprNode* init) :
     Variable(priv, type, name), init_(init)
 {
     init_->inc_ref();
@@ -89,7 +165,7 @@ void DefinedVariable::dump_node(Dumper& dumper)
     dumper.print_member("initializer", init_);
 }
 
-UndefinedVariable::UndefinedVariable(TypeNode* type, const string& name) :
+UndefinedVariable::UndefinedVariable(TypeNode* type, Symbol name) :
     Variable(false, type, name)
 {
 }
@@ -101,7 +177,7 @@ void UndefinedVariable::dump_node(Dumper& dumper)
     dumper.print_member("typeNode", tnode_);
 }
 
-Parameter::Parameter(TypeNode* type, const string& name) :
+Parameter::Parameter(TypeNode* type, Symbol name) :
     DefinedVariable(false, type, name, nullptr)
 {
 }
@@ -138,31 +214,49 @@ void Params::dump_node(Dumper& dumper)
     dumper.print_node_list("parameters", parameters());
 }
 
-Function::Function(bool priv, TypeNode* type, const string& name) :
+Function::Function(bool priv, TypeNode* type, Symbol name) :
     Entity(priv, type, name)
 {
 }
 
 Type* Function::return_type()
 {
-    auto* tp = type()->get_function_type()->return_type(); 
-    tp->inc_ref();
-    return tp;
+    return type()->get_function_type()->return_type(); 
 }
 
-DefinedFunction::DefinedFunction(bool priv, TypeNode* type, const string& name,
+DefinedFunction::DefinedFunction(bool priv, TypeNode* type, Symbol name,
         Params* params, BlockNode* body) :
 
-    Function(priv, type, name), params_(params), body_(body)
+    Function(priv, type, name), params_(params), body_(body), lazy_(nullptr)
 {
     params_->inc_ref();
     body_->inc_ref();
 }
 
+DefinedFunction::DefinedFunction(bool priv, TypeNode* type, Symbol name,
+        Params* params, LazyBody* body) :
+
+    Function(priv, type, name), params_(params), body_(nullptr), lazy_(body)
+{
+    params_->inc_ref();
+    lazy_->inc_ref();
+}
+
 DefinedFunction::~DefinedFunction()
 {
     params_->dec_ref();
     body_->dec_ref();
+    lazy_->dec_ref();
+}
+
+BlockNode* DefinedFunction::body()
+{
+    if (lazy_) {
+        body_ = lazy_->parse();
+        lazy_->dec_ref();
+        lazy_ = nullptr;
+    }
+    return body_;
 }
 
 void DefinedFunction::dump_node(Dumper& dumper)
@@ -170,11 +264,16 @@ void DefinedFunction::dump_node(Dumper& dumper)
     dumper.print_member("name", name_);
     dumper.print_member("isPrivate", priv_);
     dumper.print_member("params", params_);
-    dumper.print_member("body", body_);
+    if (lazy_) {
+        // dumping doesn't parse it
+        dumper.print_member("body", string("(lazy)"));
+    } else {
+        dumper.print_member("body", body_);
+    }
 }
 
 UndefinedFunction::UndefinedFunction(TypeNode* type, 
-        const string& name, Params* params) :
+        Symbol name, Params* params) :
 
     Function(false, type, name), params_(params)
 {
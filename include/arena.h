@@ -0,0 +1,63 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "object.h"
+
+using namespace std;
+
+namespace cbc {
+
+/* Arena is a region allocator for the Objects of one compilation.
+ * While an arena is current on a thread (see Scope), Object's
+ * operator new takes memory from it by bumping a pointer in a chunk.
+ * dec_ref() never deletes arena objects; they are all destroyed at
+ * once by ~Arena(), which walks the chunks in allocation order and
+ * then frees them. Nothing outside the compilation may keep an
+ * arena object, e.g. imported headers are loaded with no arena.
+ */
+class Arena {
+public:
+    // makes arena current until the end of the scope, nullptr
+    // suspends the current arena.
+    class Scope {
+    public:
+        Scope(Arena* arena) : saved_(current_) { current_ = arena; }
+        ~Scope() { current_ = saved_; }
+
+    protected:
+        Arena* saved_;
+    };
+
+    Arena();
+    ~Arena();
+
+    static Arena* current() { return current_; }
+
+    // returns a block of size bytes, starting with its header
+    void* allocate(size_t size);
+
+    size_t objects() { return objects_; }
+    size_t bytes() { return bytes_; }
+    size_t chunks() { return chunks_.size(); }
+
+protected:
+    struct Chunk {
+        char* base_;
+        size_t used_;
+        size_t size_;
+    };
+
+    static const size_t kChunkSize = 64 * 1024;
+    static thread_local Arena* current_;
+
+    vector<Chunk> chunks_;
+    size_t objects_;
+    size_t bytes_;
+};
+
+} // namespace cbc
+
+#endif
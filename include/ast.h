@@ -9,22 +9,28 @@ namespace cbc {
 
 class AST : public Node {
 public:
-    AST(const Location& source, Declarations* declarations);
+    AST(const Location& source, Declarations* declarations,
+        ConstantTable* constants);
     ~AST();
+    static bool classof(const Node* n) { return n->kind() == kAST; }
 
     Location location() { return source_; }
 
     string class_name() { return "AST"; }
 
+    Declarations* declarations() { return decls_; }
     vector<Constant*> constants() { return decls_->constants(); }
     vector<DefinedVariable*> defined_variables() { return decls_->defvars(); }
     vector<DefinedFunction*> defined_functions() { return decls_->deffuncs(); }
+    // the string literals, owned by whoever ran the parser
+    ConstantTable* constant_table() { return constants_; }
 
     void dump_node(Dumper& dumper);
 
 protected:
     Location source_;
     Declarations* decls_;
+    ConstantTable* constants_;
 };
 
 } // namespace cbc
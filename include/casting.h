@@ -0,0 +1,39 @@
+#ifndef CASTING_H_
+#define CASTING_H_
+
+#include <cassert>
+
+namespace cbc {
+
+/* Types, TypeRefs and Nodes keep the kind of their class, so telling
+ * them apart is comparing an integer rather than asking the RTTI. A
+ * class T says which kinds are its own in T::classof(), which covers
+ * the kinds of its subclasses too:
+ *   isa<T>(p)       whether p is a T
+ *   cast<T>(p)      p as a T, which it must be
+ *   dyn_cast<T>(p)  p as a T, or nullptr if it isn't one
+ * p must not be null. Where many kinds are told apart, switch on
+ * kind() instead.
+ */
+template<typename T, typename U>
+inline bool isa(U* p)
+{
+    return T::classof(p);
+}
+
+template<typename T, typename U>
+inline T* cast(U* p)
+{
+    assert(isa<T>(p));
+    return static_cast<T*>(p);
+}
+
+template<typename T, typename U>
+inline T* dyn_cast(U* p)
+{
+    return isa<T>(p) ? static_cast<T*>(p) : nullptr;
+}
+
+} // namespace cbc
+
+#endif
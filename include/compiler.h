@@ -0,0 +1,58 @@
+#ifndef COMPILER_H_
+#define COMPILER_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "header_cache.h"
+#include "loader.h"
+
+using namespace std;
+
+namespace cbc {
+
+/* Compiler drives the front-end over a list of source files.
+ * Every file gets its own scanner, parser and Option, so files
+ * are independent of each other and can be compiled on a pool
+ * of worker threads (see jobs_). The objects of a file are
+ * allocated from an Arena that goes away with the file. Imports
+ * are shared through the ModuleRegistry. The output of each file
+ * is buffered and printed in the order the files were given.
+ * Parsed headers can also be kept on disk across invocations,
+ * see set_import_cache().
+ */
+class Compiler {
+public:
+    Compiler();
+    ~Compiler();
+
+    // keeps precompiled headers in dir, which is created if needed
+    bool set_import_cache(const string& dir);
+
+    int compile(const vector<string>& files, ostream& os);
+    int compile_file(const string& path, ostream& os);
+
+public:
+    bool dump_ast_;
+    bool dump_tokens_;
+    bool check_types_; // print the layouts of the structs and unions
+    bool mem_report_;  // print the arena usage of each file
+    bool lazy_bodies_; // leave function bodies to DefinedFunction::body()
+    bool syntax_only_; // only check the grammar, build no AST
+    bool incremental_; // parse through a Document, see compile_document()
+    int max_errors_;   // give up on a file after that many, 0 for no limit
+    int jobs_;       // number of worker threads, <= 1 means sequential
+
+protected:
+    int compile_parallel(const vector<string>& files, ostream& os);
+    int compile_document(const string& path, const string& text,
+                         ostream& os);
+
+protected:
+    HeaderCache* header_cache_;
+};
+
+} // namespace cbc
+
+#endif
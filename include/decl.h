@@ -9,7 +9,13 @@
 namespace cbc {
 class Declarations : public Object {
 public:
+    Declarations();
     ~Declarations();
+
+    // sealed declarations are shared and must not change any more
+    void seal() { sealed_ = true; }
+    bool is_sealed() { return sealed_; }
+
     void add(Declarations* decls);
 
     void add_defvar(DefinedVariable* var);
@@ -36,8 +42,12 @@ public:
 
     void add_typedef(TypedefNode* n);
     vector<TypedefNode*> typedefs();
+
+protected:
+    void check_sealed();
     
 protected:
+    bool sealed_;
     unordered_set<DefinedVariable*> defvars_;
     unordered_set<UndefinedVariable*> declvars_;
     unordered_set<DefinedFunction*> defuncs_;
@@ -0,0 +1,94 @@
+#ifndef DOCUMENT_H_
+#define DOCUMENT_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.h"
+#include "loader.h"
+
+using namespace std;
+
+namespace cbc {
+
+/* Document keeps the AST of a source file that is being edited up to
+ * date without parsing all of it again after every change. The text
+ * is cut into its top-level definitions, and each is parsed by itself
+ * as a segment of the file (see SourceManager::add_segment()). An
+ * edit reparses the definitions it overlaps, the others are kept and
+ * only moved. A definition that changes the typedef names it declares
+ * may change how everything after it is scanned, so the rest of the
+ * file is reparsed as well then. Edits to the imports reparse it all.
+ */
+class Document {
+public:
+    Document(const string& name);
+    ~Document();
+
+    void set_output(ostream* os) { os_ = os; loader_.set_output(os); }
+    void set_header_cache(HeaderCache* cache) {
+        loader_.set_header_cache(cache);
+    }
+
+    // parses text from scratch, returns false if it has errors
+    bool parse(const string& text);
+
+    // replaces length bytes at offset with text and brings the AST up
+    // to date, returns false if the document has errors afterwards
+    bool edit(uint32_t offset, uint32_t length, const string& text);
+
+    const string& text() { return text_; }
+
+    // the definitions without errors, valid until the next change
+    AST* ast() { return ast_; }
+
+    size_t definitions() { return defs_.size(); }
+    // where the text of the i-th definition is
+    uint32_t definition_begin(size_t i) { return defs_[i].begin_; }
+    uint32_t definition_end(size_t i) { return defs_[i].end_; }
+    // definitions parsed by the last change
+    size_t reparsed() { return reparsed_; }
+
+protected:
+    struct Definition {
+        uint32_t begin_;   // in text_, from its first token
+        uint32_t end_;     // past its last token
+        bool closed_;      // else it runs to the end of the file
+        uint32_t file_;    // its segment
+        Declarations* decls_;   // nullptr if it has errors
+        vector<Symbol> typedefs_;
+    };
+
+    void clear();
+    bool ok();
+    bool parse_imports(uint32_t end);
+    Definition parse_definition(uint32_t begin, uint32_t end, bool closed,
+                                unordered_set<Symbol>& names);
+    void release(Definition& d);
+    void build_ast();
+
+protected:
+    string name_;
+    string text_;
+    uint32_t file_;
+    ostream* os_;
+    Loader loader_;
+    ConstantTable* constants_;
+
+    uint32_t imports_end_;     // the import statements come first
+    uint32_t imports_file_;
+    Declarations* imports_;
+    unordered_set<Symbol> import_types_;
+
+    vector<Definition> defs_;   // in the order of the text
+    size_t reparsed_;
+    bool failed_;   // the imports have errors
+    AST* ast_;
+};
+
+} // namespace cbc
+
+#endif
@@ -2,6 +2,7 @@
 #define ENTRY_H_
 
 #include <string>
+#include <vector>
 
 #include "util.h"
 #include "type.h"
@@ -17,11 +18,11 @@ class BlockNode;
 
 class Entity : public Object {
 public:
-    Entity(bool priv, TypeNode* type, const string& name);
+    Entity(bool priv, TypeNode* type, Symbol name);
     virtual ~Entity();
     
-    string name() { return name_; }
-    string symbol_string() { return name(); }
+    Symbol name() { return name_; }
+    string symbol_string() { return name().str(); }
 
     ExprNode* value() { throw string("Entity::value"); }
     TypeNode* type_node() { return tnode_; }
@@ -54,7 +55,7 @@ protected:
     virtual void dump_node(Dumper& dumper) = 0;
 
 protected:
-    string name_;
+    Symbol name_;
     bool priv_;
     TypeNode* tnode_;
     long nref_;
@@ -64,7 +65,7 @@ protected:
 
 class Constant : public Entity {
 public:
-    Constant(TypeNode* tnode, const string& name, ExprNode* expr);
+    Constant(TypeNode* tnode, Symbol name, ExprNode* expr);
     ~Constant();
     bool is_assignable() { return false; }
     bool is_defined() { return true; }
@@ -78,23 +79,59 @@ protected:
     void dump_node(Dumper& dumper);
 
 protected:
-    string name_;
-    TypeNode* tnode_;
     ExprNode* value_;
 };
 
-/* TODO: */
+/* A string literal as it will be emitted. Equal literals of a
+ * compilation share one entry, see ConstantTable.
+ */
 class ConstantEntry : public Object {
 public:
-    ConstantEntry(const string& val);
+    ConstantEntry(const string& val, long index);
+
+    const string& value() { return val_; }
+    long size() { return val_.size(); }   // in bytes, without the NUL
+    long index() { return index_; }       // in the table, from 0
 
 protected:
+    friend class ConstantTable;
+
     string val_;
+    long index_;
+};
+
+/* The string constants of a compilation, each distinct value stored
+ * once. Entries are numbered in the order they are first seen and
+ * stay valid as long as the table or a node holding them.
+ */
+class ConstantTable {
+public:
+    ConstantTable();
+    ~ConstantTable();
+
+    // the entry for val, made on first use, borrowed from the table
+    ConstantEntry* intern(const string& val);
+
+    // drops the entries only the table holds and numbers the others
+    // again, for tables that outlive the nodes, see Document
+    void collect();
+
+    const vector<ConstantEntry*>& entries() { return entries_; }
+    bool empty() { return entries_.empty(); }
+
+protected:
+    // fills size slots from the entries
+    void rehash(size_t size);
+
+protected:
+    vector<ConstantEntry*> entries_;  // by index
+    vector<uint32_t> slots_;    // index + 1 of the entry hashed there
+    vector<uint32_t> hashes_;   // of the entries, by index
 };
 
 class Variable : public Entity {
 public:
-    Variable(bool priv, TypeNode* type, const string& name);
+    Variable(bool priv, TypeNode* type, Symbol name);
     string class_name() { return "Variable"; }
 };
 
@@ -102,7 +139,7 @@ public:
 class DefinedVariable : public Variable {
 public:
     DefinedVariable(bool priv, TypeNode* type,
-        const string& name, ExprNode* init);
+        Symbol name, ExprNode* init);
 
     ~DefinedVariable();
 
@@ -124,7 +161,7 @@ protected:
 
 class UndefinedVariable : public Variable {
 public:
-    UndefinedVariable(TypeNode* type, const string& name);
+    UndefinedVariable(TypeNode* type, Symbol name);
 
     bool is_defined() { return false; }
     bool is_private() { return false; }
@@ -134,7 +171,7 @@ public:
 
 class Parameter : public DefinedVariable {
 public:
-    Parameter(TypeNode* type, const string& name);
+    Parameter(TypeNode* type, Symbol name);
 
     bool is_parameter() { return true; }
     
@@ -160,7 +197,7 @@ public:
 
 class Function : public Entity {
 public:
-    Function(bool priv, TypeNode* t, const string& name);
+    Function(bool priv, TypeNode* t, Symbol name);
 
     virtual vector<Parameter*> parameters() = 0;
 
@@ -170,32 +207,47 @@ public:
     Type* return_type();
 };
 
+/* The body of a function that is only parsed when somebody asks for
+ * it, see Option::lazy_.
+ */
+class LazyBody : public Object {
+public:
+    // returns a new block, throws string if it has syntax errors
+    virtual BlockNode* parse() = 0;
+};
+
 class DefinedFunction : public Function {
 public:
-    DefinedFunction(bool priv, TypeNode* t, const string& name, 
+    DefinedFunction(bool priv, TypeNode* t, Symbol name, 
         Params* params, BlockNode* body);
+    DefinedFunction(bool priv, TypeNode* t, Symbol name,
+        Params* params, LazyBody* body);
 
     ~DefinedFunction();
 
     bool is_defined() { return true;}
     string class_name() { return "DefinedFunction"; }
     vector<Parameter*> parameters() { return params_->parameters(); }
+    // parses a lazy body the first time
+    BlockNode* body();
 
     void dump_node(Dumper& dumper);
 
 protected:
     Params* params_;
     BlockNode* body_;
+    LazyBody* lazy_;
 };
 
 class UndefinedFunction : public Function {
 public:
-    UndefinedFunction(TypeNode* t, const string& name, Params* params);
+    UndefinedFunction(TypeNode* t, Symbol name, Params* params);
     ~UndefinedFunction();
 
     bool is_defined() { return false; }
     string class_name() { return "UndefinedFunction"; }
     vector<Parameter*> parameters() { return params_->parameters(); }
+    Params* params() { return params_; }
 
     void dump_node(Dumper& dumper);
 
@@ -0,0 +1,76 @@
+#ifndef FRONT_END_H_
+#define FRONT_END_H_
+
+#include "option.h"
+#include "source.h"
+
+namespace parser {
+class Parser;
+class Recognizer;
+}
+
+namespace cbc {
+
+/* FrontEnd is a scanner, a parser and the Option they share. Setting
+ * them up and tearing them down costs more than parsing a small file,
+ * so they are kept in a pool of each thread once a file is done, and
+ * the next file just resets them: the scanner is pointed at the new
+ * buffer, the parser clears its stack when it starts, and the Option
+ * keeps the memory of its containers. Imports are parsed while the
+ * file importing them is, so a thread may hold a few at a time.
+ */
+class FrontEnd {
+public:
+    // holds one of the pool for a scope
+    class Lease {
+    public:
+        Lease() : front_end_(FrontEnd::acquire()) {}
+        ~Lease() { FrontEnd::release(front_end_); }
+
+        // a copy would put the same one back twice
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        FrontEnd* operator->() { return front_end_; }
+        FrontEnd* get() { return front_end_; }
+
+    protected:
+        FrontEnd* front_end_;
+    };
+
+    // takes one from the pool of this thread, or makes one
+    static FrontEnd* acquire();
+    // resets it and puts it back
+    static void release(FrontEnd* front_end);
+
+    Option& option() { return option_; }
+
+    // the scanner reads source in place from now on
+    void scan(SourceFile* source);
+    // parses what scan() was given with the start symbol of option()
+    int parse();
+    // the same without building anything, see parser/recognizer.y
+    int recognize();
+
+    // for those reading the tokens themselves, a yyscan_t
+    void* scanner() { return scanner_; }
+
+protected:
+    friend struct FrontEndPool;
+
+    FrontEnd();
+    ~FrontEnd();
+
+    void reset();
+
+protected:
+    void* scanner_;
+    void* buffer_;   // YY_BUFFER_STATE of scan()
+    parser::Parser* parser_;
+    parser::Recognizer* recognizer_;   // made when first needed
+    Option option_;
+};
+
+} // namespace cbc
+
+#endif
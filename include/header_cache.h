@@ -0,0 +1,56 @@
+#ifndef HEADER_CACHE_H_
+#define HEADER_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace cbc {
+class Declarations;
+
+/* HeaderCache keeps the parsed declarations of .hb headers in a
+ * directory so that later invocations don't have to parse them again.
+ * An entry is named after the resolved path of the header and holds
+ * the content hash of the header and the compiler version; it is only
+ * used if both still match. Only the header's own declarations are
+ * stored, the headers it imports are recorded by libid and loaded
+ * (from the cache as well) when the entry is used. With each import
+ * goes its key (see ModuleRegistry::key()) at the time the entry was
+ * stored: the typedefs of the imports decide how the header parses,
+ * so the entry is stale as soon as one of them, or anything it
+ * imports in turn, has changed. Numbers are stored in the byte order
+ * of the host, an entry written by another one is ignored.
+ */
+class HeaderCache {
+public:
+    HeaderCache(const string& dir) : dir_(dir) {}
+
+    static uint64_t hash(const char* data, size_t size);
+    // mixes v into the hash h
+    static uint64_t combine(uint64_t h, uint64_t v);
+
+    // returns new declarations or nullptr if there is no valid entry,
+    // the libids the header imports are stored into imports and their
+    // keys into import_keys. The locations are in file, the id of the
+    // header in SourceManager.
+    Declarations* load(const string& path, uint32_t file, uint64_t hash,
+                       vector<string>* imports,
+                       vector<uint64_t>* import_keys);
+
+    // failures are silently ignored, the cache is just an optimization
+    void store(const string& path, uint64_t hash,
+               const vector<string>& imports,
+               const vector<uint64_t>& import_keys, Declarations* own);
+
+protected:
+    string entry_path(const string& realpath);
+
+protected:
+    string dir_;
+};
+
+} // namespace cbc
+
+#endif
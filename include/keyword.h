@@ -0,0 +1,132 @@
+#ifndef KEYWORD_H_
+#define KEYWORD_H_
+
+#include <cstddef>
+#include <cstring>
+
+#include "parser/parser.hh"
+
+namespace cbc {
+
+/* The scanner has a single rule for identifiers and keywords, the
+ * keywords are told apart by a perfect hash of their first and last
+ * characters and their length. The slot table is built at compile
+ * time, and the static_assert below fails if a new keyword makes the
+ * hash collide; then pick other multipliers in keyword_hash().
+ */
+struct Keyword {
+    const char* name_;
+    size_t length_;
+    int token_;
+};
+
+#define KEYWORD(name, tok) { name, sizeof(name) - 1, parser::Parser::token::tok }
+
+constexpr Keyword kKeywords[] = {
+    KEYWORD("void", VOID),
+    KEYWORD("char", CHAR),
+    KEYWORD("short", SHORT),
+    KEYWORD("int", INT),
+    KEYWORD("long", LONG),
+    KEYWORD("struct", STRUCT),
+    KEYWORD("union", UNION),
+    KEYWORD("enum", ENUM),
+    KEYWORD("extern", EXTERN),
+    KEYWORD("static", STATIC),
+    KEYWORD("const", CONST),
+    KEYWORD("sizeof", SIZEOF),
+    KEYWORD("signed", SIGNED),
+    KEYWORD("unsigned", UNSIGNED),
+    KEYWORD("if", IF),
+    KEYWORD("else", ELSE),
+    KEYWORD("switch", SWITCH),
+    KEYWORD("case", CASE),
+    KEYWORD("default", DEFAULT),
+    KEYWORD("while", WHILE),
+    KEYWORD("do", DO),
+    KEYWORD("for", FOR),
+    KEYWORD("return", RETURN),
+    KEYWORD("break", BREAK),
+    KEYWORD("continue", CONTINUE),
+    KEYWORD("goto", GOTO),
+    KEYWORD("typedef", TYPEDEF),
+    KEYWORD("import", IMPORT),
+};
+
+#undef KEYWORD
+
+constexpr int kNumKeywords = sizeof(kKeywords) / sizeof(kKeywords[0]);
+constexpr unsigned kKeywordSlots = 64;
+
+constexpr unsigned keyword_hash(const char* p, size_t n)
+{
+    return ((unsigned char)p[0] * 2 + (unsigned char)p[n - 1] * 33 +
+            n * 13) % kKeywordSlots;
+}
+
+// index in kKeywords of the keyword hashed to slot, or -1
+constexpr int keyword_at(unsigned slot, int i = 0)
+{
+    return i == kNumKeywords ? -1 :
+        keyword_hash(kKeywords[i].name_, kKeywords[i].length_) == slot ?
+            i : keyword_at(slot, i + 1);
+}
+
+constexpr int keywords_at(unsigned slot, int i = 0)
+{
+    return i == kNumKeywords ? 0 :
+        (keyword_hash(kKeywords[i].name_, kKeywords[i].length_) == slot) +
+            keywords_at(slot, i + 1);
+}
+
+constexpr bool is_perfect_hash(unsigned slot = 0)
+{
+    return slot == kKeywordSlots ||
+        (keywords_at(slot) <= 1 && is_perfect_hash(slot + 1));
+}
+
+static_assert(is_perfect_hash(), "keywords collide in keyword_hash()");
+
+template<int... I>
+struct IndexSeq {};
+
+template<int N, int... I>
+struct MakeIndexSeq : MakeIndexSeq<N - 1, N - 1, I...> {};
+
+template<int... I>
+struct MakeIndexSeq<0, I...> {
+    typedef IndexSeq<I...> type;
+};
+
+template<typename Seq>
+struct KeywordSlots;
+
+template<int... I>
+struct KeywordSlots<IndexSeq<I...>> {
+    static constexpr signed char table_[sizeof...(I)] = {
+        (signed char)keyword_at(I)...
+    };
+};
+
+template<int... I>
+constexpr signed char KeywordSlots<IndexSeq<I...>>::table_[sizeof...(I)];
+
+typedef KeywordSlots<MakeIndexSeq<kKeywordSlots>::type> KeywordTable;
+
+// returns the token of the keyword at p, or 0 if it's an identifier
+inline int keyword_token(const char* p, size_t n)
+{
+    int i = KeywordTable::table_[keyword_hash(p, n)];
+    if (i < 0) {
+        return 0;
+    }
+    const Keyword& k = kKeywords[i];
+    if (k.length_ != n || memcmp(k.name_, p, n) != 0) {
+        return 0;
+    }
+    return k.token_;
+}
+
+} // namespace cbc
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef LOADER_H_
 #define LOADER_H_
 
+#include <cstdint>
 #include <string>
 #include <map>
+#include <mutex>
+#include <ostream>
 #include <set>
 #include <vector>
 
@@ -12,22 +15,95 @@ using namespace std;
 
 namespace cbc {
 class Declarations;
+class HeaderCache;
+
+/* ModuleRegistry holds the declarations of every library imported
+ * by this process, keyed by the real path of its header (see
+ * real_path()), so that a header is parsed once however many files
+ * import it, and a server doesn't mix up the headers of clients in
+ * different directories. Entries are sealed
+ * before they are published and never change afterwards, which lets
+ * the Loaders of all files share them from any thread. The registry
+ * owns one reference of each entry.
+ */
+class ModuleRegistry {
+public:
+    static ModuleRegistry& instance();
+    ~ModuleRegistry();
+
+    // the key of the header at path, which may be relative to the
+    // current directory; path itself if it can't be resolved
+    static string real_path(const string& path);
+
+    // If set, get() drops an entry whose header, or any header it
+    // imports, has been modified since it was loaded. Meant for a
+    // long-running process, see Server.
+    void set_check_mtime(bool check) { check_mtime_ = check; }
+
+    // returns the declarations or nullptr, don't dec_ref() it
+    Declarations* get(const string& path);
+
+    // the content hash of the header mixed with the keys of the
+    // headers it imports, 0 if it isn't loaded; see HeaderCache
+    uint64_t key(const string& path);
+
+    // returns the declarations actually published, which may be another
+    // thread's copy if that thread loaded the same library first.
+    // file is the header in the SourceManager, removed with the entry,
+    // mtime is the one of the header when it was read and deps are the
+    // keys of the headers it imports, which must be loaded already.
+    // hash is the content hash of the header.
+    Declarations* put(const string& path, Declarations* decls,
+                      uint32_t file, int64_t mtime,
+                      const vector<string>& deps, uint64_t hash);
+
+    // releases dropped entries, only call it while nothing is compiled
+    void collect();
+
+protected:
+    ModuleRegistry() : check_mtime_(false) {}
+    bool is_fresh(const string& path, set<string>& checked);
+
+protected:
+    struct Module {
+        Declarations* decls_;
+        uint32_t file_;
+        int64_t mtime_;
+        vector<string> deps_;
+        uint64_t key_;
+    };
+
+    mutex mutex_;
+    map<string, Module> modules_;
+    vector<Module> dropped_;  // may still be used by other threads
+    bool check_mtime_;
+};
 
 class Loader {
 public:
     Loader();
-    ~Loader();
 
     static vector<string> default_load_path();
     void add_load_path(const string& path);
+    void set_output(ostream* os) { os_ = os; }
+    void set_header_cache(HeaderCache* cache) { header_cache_ = cache; }
     Declarations* load_library(const string& name);
-    string search_library(const string& libid, int* fd);
+    string search_library(const string& libid);
     string lib_path(const string& libid);
 
+protected:
+    Declarations* load_cached(const string& path, uint32_t file,
+                              uint64_t hash, vector<string>* imports);
+    Declarations* publish(const string& path, Declarations* decls,
+                          uint32_t file, int64_t mtime, uint64_t hash,
+                          const vector<string>& imports);
+    vector<uint64_t> import_keys(const vector<string>& imports);
+
 protected:
     vector<string> load_path_;
     vector<string> loading_;
-    map<string, Declarations*> loaded_;
+    HeaderCache* header_cache_;
+    ostream* os_;
 };
 
 }
@@ -15,18 +15,73 @@ namespace cbc {
 
 class Node : public Object, public Dumpable {
 public:
-    Node() {}
+    // the class of a node, see casting.h; the kinds of the subclasses
+    // of a class are next to each other
+    enum Kind {
+        kAST,
+        kTypeNode,
+        kSlot,
+        // ExprNode
+        kIntegerLiteral,
+        kStringLiteral,
+        kVariable,
+        kAref,
+        kMember,
+        kPtrMember,
+        kDereference,
+        kUnaryOp,
+        kPrefixOp,
+        kSuffixOp,
+        kBinaryOp,
+        kLogicalOr,
+        kLogicalAnd,
+        kAssign,
+        kOpAssign,
+        kFuncall,
+        kSizeofExpr,
+        kSizeofType,
+        kAddress,
+        kCast,
+        kCondExpr,
+        // StmtNode
+        kBreak,
+        kContinue,
+        kReturn,
+        kGoto,
+        kBlock,
+        kExprStmt,
+        kLabel,
+        kCase,
+        kSwitch,
+        kFor,
+        kDoWhile,
+        kWhile,
+        kIf,
+        // TypeDefinition
+        kStruct,
+        kUnion,
+        kTypedef,
+    };
+
+    Node(Kind kind) : kind_(kind) {}
+    Kind kind() const { return kind_; }
     void dump(ostream& os=cout);
     void dump(Dumper& dumper);
     virtual string class_name() = 0;
     virtual ~Node() {};
     virtual void dump_node(Dumper& dumper) = 0;
     virtual Location location() = 0;
+
+protected:
+    const Kind kind_;
 };
 
 class ExprNode : public Node {
 public:
-    ExprNode() {}
+    ExprNode(Kind kind) : Node(kind) {}
+    static bool classof(const Node* n) {
+        return n->kind() >= kIntegerLiteral && n->kind() <= kCondExpr;
+    }
     virtual ~ExprNode() {}
     virtual Type* type() = 0;
     virtual Type* orig_type() { return type(); }
@@ -52,6 +107,7 @@ public:
     bool is_resolved() { return !!type_; } 
     void set_type(Type* tp);
     void dump_node(Dumper& dumper);
+    static bool classof(const Node* n) { return n->kind() == kTypeNode; }
     string class_name() { return "TypeNode"; }
 
 protected:
@@ -61,13 +117,16 @@ protected:
 
 class LiteralNode : public ExprNode {
 public:
-    LiteralNode(const Location& loc, TypeRef* ref);
+    LiteralNode(Kind kind, const Location& loc, TypeRef* ref);
     ~LiteralNode();
 
     Location location() { return loc_; }
     TypeNode* type_node() { return tnode_; }
     Type* type() { return tnode_->type(); }
     bool is_constant() { return true; }
+    static bool classof(const Node* n) {
+        return n->kind() >= kIntegerLiteral && n->kind() <= kStringLiteral;
+    }
     string class_name() { return "LiteralNode"; }
 
 protected:
@@ -79,6 +138,7 @@ class IntegerLiteralNode : public LiteralNode {
 public:
     IntegerLiteralNode(const Location& loc, TypeRef* ref, long value);
     long value() { return value_; }
+    static bool classof(const Node* n) { return n->kind() == kIntegerLiteral; }
     string class_name() { return "IntegerLiteralNode"; }
 
 protected:
@@ -90,8 +150,10 @@ protected:
 
 class StringLiteralNode : public LiteralNode {
 public:
-    StringLiteralNode(const Location& loc, TypeRef* ref, const string& value);
-    string value() { return value_; }
+    StringLiteralNode(const Location& loc, TypeRef* ref, ConstantEntry* entry);
+    ~StringLiteralNode();
+    const string& value() { return entry_->value(); }
+    static bool classof(const Node* n) { return n->kind() == kStringLiteral; }
     string class_name() { return "StringLiteralNode"; }
     ConstantEntry* entry() { return entry_; }
     
@@ -99,7 +161,6 @@ protected:
     void dump_node(Dumper& dumper);
 
 protected:
-    string value_;
     ConstantEntry* entry_;
 };
 
@@ -112,7 +173,7 @@ protected:
  */
 class LHSNode : public ExprNode {
 public:
-    LHSNode();
+    LHSNode(Kind kind);
     ~LHSNode();
     Type* type() { return type_ != nullptr ? type_ : orig_type(); }
     void set_type(Type* type);
@@ -120,6 +181,9 @@ public:
     bool is_lvalue() { return true; }
     bool is_assignable() { return is_loadable(); }
     bool is_loadable();
+    static bool classof(const Node* n) {
+        return n->kind() >= kVariable && n->kind() <= kDereference;
+    }
     string class_name() { return "LHSNode"; }
 
 protected:
@@ -132,10 +196,10 @@ protected:
 
 class VariableNode : public LHSNode {
 public:
-    VariableNode(const Location& loc, const string& name);
+    VariableNode(const Location& loc, Symbol name);
     VariableNode(DefinedVariable* var);
     ~VariableNode();
-    string name() { return name_; }
+    Symbol name() { return name_; }
     Location location() { return loc_; };
 
     // Entity represents variable, constant, ... etc
@@ -148,6 +212,7 @@ public:
     bool is_parameter();
     Type* orig_type();
     TypeNode* type_node();
+    static bool classof(const Node* n) { return n->kind() == kVariable; }
     string class_name() { return "VariableNode"; }
     
 protected:
@@ -155,13 +220,14 @@ protected:
 
 protected:
     Location loc_;
-    string name_;
+    Symbol name_;
     Entity* entity_;
 };
 
 class UnaryOpNode : public ExprNode {
 public:
     UnaryOpNode(const string& op, ExprNode* node);
+    UnaryOpNode(Kind kind, const string& op, ExprNode* node);
     ~UnaryOpNode();
     string op() { return op_; }
     Type* type() { return expr_->type(); }
@@ -169,6 +235,9 @@ public:
     Location location() { return expr_->location(); }
     void set_op_type(Type* type);
     void set_expr(ExprNode* expr);
+    static bool classof(const Node* n) {
+        return n->kind() >= kUnaryOp && n->kind() <= kSuffixOp;
+    }
     string class_name() { return "UnaryOpNode"; }
 
 protected:
@@ -183,9 +252,12 @@ protected:
 class UnaryArithmeticOpNode : public UnaryOpNode {
 public:
     ~UnaryArithmeticOpNode() {}
-    UnaryArithmeticOpNode(const string& op, ExprNode* expr);
+    UnaryArithmeticOpNode(Kind kind, const string& op, ExprNode* expr);
     long amount() const { return amount_; }
     void set_amount(long amount) { amount_ = amount; }
+    static bool classof(const Node* n) {
+        return n->kind() >= kPrefixOp && n->kind() <= kSuffixOp;
+    }
     string class_name() { return "UnaryArithmeticOpNode"; }
 
 protected:
@@ -195,12 +267,14 @@ protected:
 class PrefixOpNode : public UnaryArithmeticOpNode {
 public:
     PrefixOpNode(const string& op, ExprNode* expr);
+    static bool classof(const Node* n) { return n->kind() == kPrefixOp; }
     string class_name() { return "PrefixOpNode"; }
 };
 
 class SuffixOpNode : public UnaryArithmeticOpNode {
 public:
     SuffixOpNode(const string& op, ExprNode* expr);
+    static bool classof(const Node* n) { return n->kind() == kSuffixOp; }
     string class_name() { return "SuffixOpNode"; }
 };
 
@@ -226,6 +300,7 @@ public:
     long element_size() { return orig_type()->alloc_size(); }
     long length();
     Location location() { return expr_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kAref; }
     string class_name() { return "ArefNode"; }
 
 protected:
@@ -239,39 +314,41 @@ protected:
 class Slot : public Node {
 public:
     Slot();
-    Slot(TypeNode* t, const string& n);
+    Slot(TypeNode* t, Symbol n);
     ~Slot();
 
     TypeNode* type_node() { return tnode_; }
     TypeRef* type_ref() { assert(tnode_); return tnode_->type_ref(); }
     Type* type() { assert(tnode_); return tnode_->type(); }
-    string name() { return name_; }
+    Symbol name() { return name_; }
     Location location() { return tnode_->location(); }
     long size() { return type()->size(); }
     long alloc_size() { return type()->alloc_size(); }
-    long allignment() { return type()->alignment(); }
+    long alignment() { return type()->alignment(); }
     long offset() { return offset_; }
     void set_offset(long offset) { offset_ = offset; }
+    static bool classof(const Node* n) { return n->kind() == kSlot; }
     string class_name() { return "Slot"; }
 
 protected:
     void dump_node(Dumper& dumper);
 
 protected:
-    string name_;
+    Symbol name_;
     TypeNode* tnode_;
     long offset_;
 };
 
 class MemberNode : public LHSNode {
 public:
-    MemberNode(ExprNode* expr, const string& member);
+    MemberNode(ExprNode* expr, Symbol member);
     ~MemberNode();
     CompositeType* base_type();
     Location location() { return expr()->location(); }
     ExprNode* expr() { return expr_; }
-    string member() { return member_; }
+    Symbol member() { return member_; }
     long offset() { return base_type()->member_offset(member_); }
+    static bool classof(const Node* n) { return n->kind() == kMember; }
     string class_name() { return "MemberNode"; }
 
 protected:
@@ -280,19 +357,20 @@ protected:
 
 protected:
     ExprNode* expr_;
-    string member_;
+    Symbol member_;
 };
 
 class PtrMemberNode : public LHSNode {
 public:
-    PtrMemberNode(ExprNode* expr, const string& member);
+    PtrMemberNode(ExprNode* expr, Symbol member);
     ~PtrMemberNode();
     CompositeType* derefered_composite_type();
     Type* derefered_type();
     ExprNode* expr() { return expr_; }
-    string member() { return member_; }
+    Symbol member() { return member_; }
     long offset() { return derefered_composite_type()->member_offset(member_); }
     Location location() { return expr_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kPtrMember; }
     string class_name() { return "PtrMemberNode"; }
     
 protected:
@@ -301,7 +379,7 @@ protected:
 
 protected:
     ExprNode* expr_;
-    string member_;
+    Symbol member_;
 };
 
 /* TODO: */
@@ -320,6 +398,7 @@ public:
     Type* type();
     FunctionType* function_type();
 
+    static bool classof(const Node* n) { return n->kind() == kFuncall; }
     string class_name() { return "FuncallNode"; }
 
 protected:
@@ -339,6 +418,7 @@ public:
     Type* type() { return tnode_->type(); }
     TypeNode* typeNode() { return tnode_; }
     Location location() { return expr_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kSizeofExpr; }
     string class_name() { return "SizeofExprNode"; }
 
 protected:
@@ -358,6 +438,7 @@ public:
     TypeNode* operand_type_node() { return op_; }
     TypeNode* type_node() { return tnode_; }
     Location location() { return op_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kSizeofType; }
     string class_name() { return "SizeofTypeNode"; }
 
 protected:
@@ -376,6 +457,7 @@ public:
     Type* type();
     void set_type(Type* type);
     Location location() { return expr_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kAddress; }
     string class_name() { return "AddressNode"; }
 
 protected:
@@ -394,6 +476,7 @@ public:
     ExprNode* expr() { return expr_; }
     void set_expr(ExprNode* expr);
     Location location() { return expr_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kDereference; }
     string class_name() { return "DereferenceNode"; }
 
 protected:
@@ -415,6 +498,7 @@ public:
     bool is_assignable() { return expr_->is_assignable(); }
     bool is_effectiveCast() { return type()->size() > expr_->type()->size(); }
     Location location() { return tnode_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kCast; }
     string class_name() { return "CastNode"; }
 
 protected:
@@ -429,6 +513,7 @@ class BinaryOpNode : public ExprNode {
 public:
     BinaryOpNode(ExprNode* left, const string& op, ExprNode* right);
     BinaryOpNode(Type* t, ExprNode* left, const string& op, ExprNode* right);
+    BinaryOpNode(Kind kind, ExprNode* left, const string& op, ExprNode* right);
     ~BinaryOpNode();
     string op() { return op_; }
     Type* type() { return type_ ? type_ : left_->type(); }
@@ -439,6 +524,9 @@ public:
     void set_right(ExprNode* r) { right_ = r; }
 
     Location location() { return left_->location(); }
+    static bool classof(const Node* n) {
+        return n->kind() >= kBinaryOp && n->kind() <= kLogicalAnd;
+    }
     string class_name() { return "BinaryOpNode"; }
 
 protected:
@@ -465,6 +553,7 @@ public:
     void set_else_expr(ExprNode* expr);
 
     Location location() { return cond_->location(); }
+    static bool classof(const Node* n) { return n->kind() == kCondExpr; }
     string class_name() { return "CondExprNode"; }
 
 protected:
@@ -479,18 +568,20 @@ protected:
 class LogicalOrNode : public BinaryOpNode {
 public:
     LogicalOrNode(ExprNode* left, ExprNode* right);
+    static bool classof(const Node* n) { return n->kind() == kLogicalOr; }
     string class_name() { return "LogicalOrNode"; }
 };
 
 class LogicalAndNode : public BinaryOpNode {
 public:
     LogicalAndNode(ExprNode* left, ExprNode* right);
+    static bool classof(const Node* n) { return n->kind() == kLogicalAnd; }
     string class_name() { return "LogicalAndNode"; }
 };
 
 class AbstractAssignNode : public ExprNode {
 public:
-    AbstractAssignNode(ExprNode* lhs, ExprNode* rhs);
+    AbstractAssignNode(Kind kind, ExprNode* lhs, ExprNode* rhs);
     ~AbstractAssignNode();
 
     Type* type() { return lhs_->type(); }
@@ -500,6 +591,9 @@ public:
     void set_rhs(ExprNode* expr);
 
     Location location() { return lhs_->location(); }
+    static bool classof(const Node* n) {
+        return n->kind() >= kAssign && n->kind() <= kOpAssign;
+    }
     string class_name() { return "AbstractAssignNode"; }
 
 protected:
@@ -513,6 +607,7 @@ protected:
 class AssignNode : public AbstractAssignNode {
 public:
     AssignNode(ExprNode* lhs, ExprNode* rhs);
+    static bool classof(const Node* n) { return n->kind() == kAssign; }
     string class_name() { return "AssignNode"; }
 };
 
@@ -520,6 +615,7 @@ class OpAssignNode : public AbstractAssignNode {
 public:
     OpAssignNode(ExprNode* lhs, const string& op, ExprNode* rhs);
     string op() { return op_; }
+    static bool classof(const Node* n) { return n->kind() == kOpAssign; }
     string class_name() { return "OpAssignNode"; }
 
 protected:
@@ -528,7 +624,10 @@ protected:
 
 class StmtNode : public Node {
 public:
-    StmtNode(const Location& loc);
+    StmtNode(Kind kind, const Location& loc);
+    static bool classof(const Node* n) {
+        return n->kind() >= kBreak && n->kind() <= kIf;
+    }
     Location location() { return loc_; }
 
 protected:
@@ -538,6 +637,7 @@ protected:
 class BreakNode : public StmtNode {
 public: 
     BreakNode(const Location& loc);
+    static bool classof(const Node* n) { return n->kind() == kBreak; }
     string class_name() { return "BreakNode"; }
 
 protected:
@@ -547,6 +647,7 @@ protected:
 class ContinueNode : public StmtNode {
 public: 
     ContinueNode(const Location& loc);
+    static bool classof(const Node* n) { return n->kind() == kContinue; }
     string class_name() { return "ContinueNode"; }
 
 protected:
@@ -561,6 +662,7 @@ public:
     ExprNode* expr() { return expr_; }
     void set_expr(ExprNode* expr);
 
+    static bool classof(const Node* n) { return n->kind() == kReturn; }
     string class_name() { return "ReturnNode"; }
 
 protected:
@@ -572,15 +674,16 @@ protected:
 
 class GotoNode : public StmtNode {
 public:
-    GotoNode(const Location& loc, const string& target);
-    string target() { return target_; }
+    GotoNode(const Location& loc, Symbol target);
+    Symbol target() { return target_; }
+    static bool classof(const Node* n) { return n->kind() == kGoto; }
     string class_name() { return "GotoNode"; }
 
 protected:
     void dump_node(Dumper& dumper);
 
 protected:
-    string target_;
+    Symbol target_;
 };
 
 // TODO：
@@ -595,6 +698,7 @@ public:
     vector<StmtNode*> stmts() { return stmts_; }
     StmtNode* tail_stmt();
 
+    static bool classof(const Node* n) { return n->kind() == kBlock; }
     string class_name() { return "BlockNode"; }
 
 protected:
@@ -612,6 +716,7 @@ public:
     
     ExprNode* expr() { return expr_; }
     void set_expr(ExprNode* expr);
+    static bool classof(const Node* n) { return n->kind() == kExprStmt; }
     string class_name() { return "ExprStmtNode"; }
 
 protected:
@@ -623,18 +728,19 @@ protected:
 
 class LabelNode : public StmtNode {
 public:
-    LabelNode(const Location& loc, const string& name, StmtNode* stmt);
+    LabelNode(const Location& loc, Symbol name, StmtNode* stmt);
     ~LabelNode();
 
-    string name() { return name_; }
+    Symbol name() { return name_; }
     StmtNode* stmt() { return stmt_; }
+    static bool classof(const Node* n) { return n->kind() == kLabel; }
     string class_name() { return "LabelNode"; }
 
 protected:
     void dump_node(Dumper& dumper);
 
 protected:
-    string name_;
+    Symbol name_;
     StmtNode* stmt_;
 };
 
@@ -647,6 +753,7 @@ public:
     BlockNode* body() { return body_; }
 
     bool is_default(int n) { return values_.at(n) == nullptr; }
+    static bool classof(const Node* n) { return n->kind() == kCase; }
     string class_name() { return "CaseNode"; }
 
 protected:
@@ -667,6 +774,7 @@ public:
     ExprNode* cond() { return cond_; }
     vector<CaseNode*> cases() { return cases_; }
 
+    static bool classof(const Node* n) { return n->kind() == kSwitch; }
     string class_name() { return "SwitchNode"; }
 
 protected:
@@ -689,6 +797,7 @@ public:
     StmtNode* incr() { return incr_; }
     StmtNode* body() { return body_; }
 
+    static bool classof(const Node* n) { return n->kind() == kFor; }
     string class_name() { return "ForNode"; }
 
 protected:
@@ -708,6 +817,7 @@ public:
 
     StmtNode* body() { return body_; }
     ExprNode* cond() { return cond_; }
+    static bool classof(const Node* n) { return n->kind() == kDoWhile; }
     string class_name() { return "DoWhileNode"; }
 
 protected:
@@ -725,6 +835,7 @@ public:
 
     StmtNode* body() { return body_; }
     ExprNode* cond() { return cond_; }
+    static bool classof(const Node* n) { return n->kind() == kWhile; }
     string class_name() { return "DoWhileNode"; }
 
 protected:
@@ -744,6 +855,7 @@ public:
     ExprNode* cond() { return cond_; }
     StmtNode* then_body() { return then_body_; }
     StmtNode* else_body() { return else_body_; }
+    static bool classof(const Node* n) { return n->kind() == kIf; }
     string class_name() { return "IfNode"; }
 
 protected:
@@ -757,29 +869,34 @@ protected:
 
 class TypeDefinition : public Node {
 public:
-    TypeDefinition(const Location& loc, TypeRef* ref, const string& name);
+    TypeDefinition(Kind kind, const Location& loc, TypeRef* ref, Symbol name);
+    static bool classof(const Node* n) {
+        return n->kind() >= kStruct && n->kind() <= kTypedef;
+    }
     ~TypeDefinition();
 
     Location location() { return loc_; }
-    string name() { return name_; }
+    Symbol name() { return name_; }
     TypeNode* type_node() { return tnode_; }
     TypeRef* type_ref() { return tnode_->type_ref(); }
     Type* type() { return tnode_->type(); }
     virtual Type* defining_type() = 0;
 
 protected:
-    string name_;
+    Symbol name_;
     Location loc_;
     TypeNode* tnode_;
 };
 
 class CompositeTypeDefinition : public TypeDefinition {
 public:
-    CompositeTypeDefinition(const Location &loc, TypeRef* ref,
-                            const string& name, vector<Slot*>&& membs);
+    CompositeTypeDefinition(Kind kind, const Location &loc, TypeRef* ref,
+                            Symbol name, vector<Slot*>&& membs);
     ~CompositeTypeDefinition();
 
-    virtual string kind() = 0;
+    static bool classof(const Node* n) {
+        return n->kind() == kStruct || n->kind() == kUnion;
+    }
 
     bool is_compositeType() { return true; }
     vector<Slot*> members() { return members_; }
@@ -792,9 +909,9 @@ public:
 class StructNode : public CompositeTypeDefinition {
 public:
     StructNode(const Location &loc, TypeRef* ref,
-                const string& name, vector<Slot*>&& membs);
+                Symbol name, vector<Slot*>&& membs);
 
-    string kind() { return "struct"; }
+    static bool classof(const Node* n) { return n->kind() == kStruct; }
     string class_name() { return "StructNode"; }
     bool is_struct() { return true; }
     Type* defining_type();
@@ -803,9 +920,9 @@ public:
 class UnionNode : public CompositeTypeDefinition {
 public:
     UnionNode(const Location &loc, TypeRef* ref,
-                const string& name, vector<Slot*>&& membs);
+                Symbol name, vector<Slot*>&& membs);
 
-    string kind() { return "union"; }
+    static bool classof(const Node* n) { return n->kind() == kUnion; }
     string class_name() { return "UnionNode"; }
     bool is_union() { return true; }
     Type* defining_type();
@@ -813,13 +930,14 @@ public:
 
 class TypedefNode : public TypeDefinition {
 public:
-    TypedefNode(const Location& loc, TypeRef* ref, const string& name);
+    TypedefNode(const Location& loc, TypeRef* ref, Symbol name);
     ~TypedefNode();
     bool is_user_type() { return true; }
     TypeNode* real_type_node() { return real_; }
     Type* real_type() { return real_->type(); }
     TypeRef* real_type_ref() { return real_->type_ref(); }
     Type* defining_type();
+    static bool classof(const Node* n) { return n->kind() == kTypedef; }
     string class_name() { return "TypedefNode"; }
 
 protected:
@@ -3,6 +3,8 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 /* XXX: Object should be always used as pointers.
  * It can also use c++ shared_ptr to manage the memory,
@@ -12,9 +14,31 @@
  * 3) move operation doesn't change reference count.
  * 4) when an internal pointer is passed out, inc_ref() should be called, 
  *    and when this pointer is not used, dec_ref() should be called.
+ *    Functions handing out a reference return a RefPtr (see ref_ptr.h),
+ *    which the caller moves along or lets release it. Plain lookups
+ *    such as members() or base_type() return borrowed pointers that
+ *    stay valid as long as their owner, and must not be dec_ref()ed.
+ * Objects created while an Arena is current live in that arena and are
+ * only destroyed with it, dec_ref() never deletes them (see arena.h).
  */
 namespace cbc {
 
+// inc_ref()/dec_ref() calls made on this thread, see --mem-report
+extern thread_local unsigned long ref_ops;
+
+/* Every Object is preceded by a header telling where it lives. */
+struct ObjectHeader {
+    enum {
+        kHeap = 0x68656170,
+        kArena,
+        kDead,      // destroyed by its arena, or its constructor threw
+    };
+
+    uint32_t tag_;
+    uint32_t size_;      // of the whole block, including the header
+    uint64_t reserved_;  // keeps objects 16 bytes aligned
+};
+
 class Object {
 public:
     Object() : oref_(1) {
@@ -25,6 +49,9 @@ public:
         // printf("destroy object\n");
     };
 
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
     /* for hash table, see declaration.h */
     virtual bool equals(Object* other) { return this == other; }
 
@@ -32,20 +59,49 @@ public:
         return oref_;
     }
 
+    bool in_arena() {
+        return ((ObjectHeader*)this - 1)->tag_ == ObjectHeader::kArena;
+    }
+
+    /* An arena belongs to one compilation on one thread, so the count
+     * of an arena object is updated with plain loads and stores. Only
+     * heap objects, which may be published to other threads (e.g.
+     * imports in the ModuleRegistry), pay for atomic updates.
+     */
     void inc_ref() {
         if (this) {
-            ++oref_;
+            ref_ops++;
+            if (in_arena()) {
+                oref_.store(oref_.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+            } else {
+                oref_.fetch_add(1);
+            }
         }
     }
 
+    /* Objects that ~Arena() already destroyed may still be released
+     * by the destructors of objects it destroys after them, that is a
+     * no-op.
+     */
     void dec_ref(int n=1) {
         if (this) {
-            oref_ -= n;
-            if (oref_ == 0) {
+            ref_ops++;
+            uint32_t tag = ((ObjectHeader*)this - 1)->tag_;
+            if (tag != ObjectHeader::kHeap) {
+                if (tag == ObjectHeader::kArena) {
+                    int ref = oref_.load(std::memory_order_relaxed) - n;
+                    oref_.store(ref, std::memory_order_relaxed);
+                    assert(ref >= 0);
+                }
+                return;
+            }
+            int ref = oref_.fetch_sub(n) - n;
+            if (ref == 0) {
                 delete this;
                 return;
             }
-            assert(oref_ >= 1);
+            assert(ref >= 1);
         }
     }
 
@@ -1,28 +1,71 @@
 #ifndef OPTION_H_
 #define OPTION_H_
 
-#include <set>
+#include <iostream>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "ast.h"
 #include "loader.h"
+#include "symbol.h"
 #include "type_table.h"
+#include "util.h"
 
 using namespace std;
 
 struct Option {
-    Option() : ast_(nullptr), decl_(nullptr), start_(0) {}
+    Option() { reset(); }
     ~Option() {
         // don't delete anything in option
     }
 
+    // back to the defaults for the next file, keeping the memory of
+    // the containers, see FrontEnd
+    void reset() {
+        ast_ = nullptr;
+        decl_ = nullptr;
+        own_decl_ = nullptr;
+        type_table_ = nullptr;
+        constants_ = nullptr;
+        loader_ = nullptr;
+        start_ = 0;
+        src_.clear();
+        file_ = 0;
+        text_ = nullptr;
+        os_ = &cout;
+        errors_ = nullptr;
+        typename_.clear();
+        imports_.clear();
+        lazy_ = false;
+        depth_ = 0;
+        body_next_ = false;
+        bodies_ = nullptr;
+        block_ = nullptr;
+    }
+
     cbc::AST* ast_;
     cbc::Declarations* decl_;
+    cbc::Declarations* own_decl_;  // decl_ without the imports, .hb only
     cbc::TypeTable* type_table_;
-    cbc::Loader loader_;
+    cbc::ConstantTable* constants_;  // string literals go there
+    cbc::Loader* loader_;  // shared by the file and the headers it imports
     int start_;      // pseudo start symbpl, see parser.y
     string src_;     // source file name
-    set<string> typename_;
+    uint32_t file_;  // and its id, see SourceManager
+    const char* text_;   // the buffer being scanned
+    ostream* os_;    // where dumps of this file go
+    cbc::ErrorHandler* errors_;  // and its diagnostics
+    unordered_set<cbc::Symbol> typename_;
+    vector<string> imports_;  // libids imported by this file
+
+    // Function bodies are skipped with their braces if lazy_ is set,
+    // and only parsed by DefinedFunction::body(), see parser.y.
+    bool lazy_;
+    int depth_;        // of braces at the last token
+    bool body_next_;   // a '{' now opens a function body
+    cbc::Object* bodies_;   // what the skipped bodies share, to dec_ref()
+    cbc::BlockNode* block_; // the result of a BLOCK parse
 };
 
 #endif
\ No newline at end of file
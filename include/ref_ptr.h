@@ -0,0 +1,62 @@
+#ifndef REF_PTR_H_
+#define REF_PTR_H_
+
+#include <cstddef>
+#include <utility>
+
+#include "object.h"
+
+namespace cbc {
+
+/* RefPtr owns one reference of an Object. Copying a RefPtr takes
+ * another reference, moving it just hands the reference over, so it
+ * can be returned and passed along without touching the count.
+ * RefPtr(p) takes a new reference of p, adopt(p) wraps a reference
+ * the caller already owns, e.g. the one of a new object.
+ * The type and entity APIs use it; AST nodes still hold their
+ * children as raw pointers released by their destructors.
+ */
+template<typename T>
+class RefPtr {
+public:
+    RefPtr() : p_(nullptr) {}
+    RefPtr(std::nullptr_t) : p_(nullptr) {}
+    explicit RefPtr(T* p) : p_(p) { if (p_) p_->inc_ref(); }
+    RefPtr(const RefPtr& other) : p_(other.p_) { if (p_) p_->inc_ref(); }
+    RefPtr(RefPtr&& other) : p_(other.p_) { other.p_ = nullptr; }
+
+    template<typename U>
+    RefPtr(RefPtr<U>&& other) : p_(other.release()) {}
+
+    ~RefPtr() { if (p_) p_->dec_ref(); }
+
+    RefPtr& operator=(RefPtr other) {
+        std::swap(p_, other.p_);
+        return *this;
+    }
+
+    static RefPtr adopt(T* p) {
+        RefPtr r;
+        r.p_ = p;
+        return r;
+    }
+
+    T* get() const { return p_; }
+    T* operator->() const { return p_; }
+    T& operator*() const { return *p_; }
+    explicit operator bool() const { return p_ != nullptr; }
+
+    // gives the reference up to the caller
+    T* release() {
+        T* p = p_;
+        p_ = nullptr;
+        return p;
+    }
+
+private:
+    T* p_;
+};
+
+} // namespace cbc
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+namespace cbc {
+
+/* Searches used by the scanner to get through comments and literals
+ * without going through its DFA one byte at a time. They look at 16
+ * or 32 bytes at once with SSE2 or AVX2, whichever the CPU has, and
+ * fall back to plain loops elsewhere. Both return end when there is
+ * nothing to find.
+ */
+
+// the "*/" closing a comment, at or after p
+const char* find_comment_end(const char* p, const char* end);
+
+// the quote closing a string or character literal whose body starts
+// at p, characters escaped with a backslash don't count
+const char* find_quote(const char* p, const char* end, char quote);
+
+// the '}' closing the block whose '{' is just before p, braces in
+// comments and literals don't count
+const char* find_block_end(const char* p, const char* end);
+
+} // namespace cbc
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SERIALIZE_H_
+#define SERIALIZE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "decl.h"
+
+using namespace std;
+
+namespace cbc {
+
+/* Binary form of the Declarations read from a .hb header, used by the
+ * precompiled header cache (see header_cache.h). Only what a header can
+ * contain is supported: declared functions and variables, constants,
+ * structs, unions and typedefs. Constant values may be any expression
+ * made of literals, variables and operators; anything else makes
+ * DeclWriter throw, in which case the header simply isn't cached.
+ */
+class DeclWriter {
+public:
+    DeclWriter(string& out) : out_(out) {}
+
+    void write(Declarations* decls);
+
+    void write_u8(uint8_t v);
+    void write_u32(uint32_t v);
+    void write_u64(uint64_t v);
+    void write_string(const string& s);
+    // symbols are written as text, their ids differ between processes
+    void write_symbol(Symbol s) { write_string(s.str()); }
+
+protected:
+    void write_location(Location loc);
+    void write_typeref(TypeRef* ref);
+    void write_params(Params* params);
+    void write_slots(const vector<Slot*>& slots);
+    void write_expr(ExprNode* expr);
+
+protected:
+    string& out_;
+};
+
+class DeclReader {
+public:
+    // the locations read are in file
+    DeclReader(const char* data, size_t size, uint32_t file) :
+        p_(data), end_(data + size), file_(file) {}
+
+    // returns new declarations, throws string on malformed input
+    Declarations* read();
+
+    uint8_t read_u8();
+    uint32_t read_u32();
+    uint64_t read_u64();
+    string read_string();
+    Symbol read_symbol();
+
+protected:
+    Location read_location();
+    TypeRef* read_typeref();
+    Params* read_params();
+    vector<Slot*> read_slots();
+    ExprNode* read_expr();
+    void need(size_t n);
+
+protected:
+    const char* p_;
+    const char* end_;
+    uint32_t file_;
+    ConstantTable constants_;
+};
+
+} // namespace cbc
+
+#endif
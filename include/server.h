@@ -0,0 +1,55 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace cbc {
+
+/* Server keeps may running on a Unix domain socket so that imported
+ * headers stay loaded between compilations (see ModuleRegistry).
+ * A client sends its working directory and argv, the server runs them
+ * through the handler and streams the output back, followed by the
+ * exit status. Requests are served one at a time because each runs
+ * in the working directory of its client; the server goes back to its
+ * own directory after each of them.
+ *
+ * Symbols are never freed (see Symbol), so a server that has seen
+ * most of the ids the table can hold returns from run() to be
+ * restarted; clients that come meanwhile compile by themselves.
+ * Malformed requests close the connection without a reply.
+ */
+class Server {
+public:
+    typedef function<int(const vector<string>& args, ostream& os)> Handler;
+
+    Server(const string& path, Handler handler);
+    ~Server();
+
+    // returns 1 if the socket can't be set up or the directory the
+    // server started in is gone, 0 if the process should be restarted
+    // to get a fresh symbol table
+    int run();
+
+    // runs args on the server listening at path and copies its output
+    // to os. returns the exit status, or -1 if there is no server.
+    static int forward(const string& path, const vector<string>& args,
+                       ostream& os);
+
+protected:
+    void serve(int fd);
+
+protected:
+    string path_;       // absolute, serve() changes the directory
+    string dir_;        // where the server was started
+    Handler handler_;
+    int fd_;
+};
+
+} // namespace cbc
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SOURCE_H_
+#define SOURCE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace cbc {
+
+/* SourceFile keeps the whole content of a source file in memory so
+ * that the scanner can work on it in place (see yy_scan_buffer()).
+ * The content is always followed by the two NUL bytes flex needs as
+ * end-of-buffer marks. The file is mmap()ed when the tail of its last
+ * page has room for them, otherwise it is read() in one block.
+ */
+class SourceFile {
+public:
+    SourceFile();
+    ~SourceFile();
+
+    // returns false and leaves errno set if the file can't be read
+    bool load(const string& path);
+    // takes a copy of text instead, for sources that aren't on disk
+    void assign(const char* text, size_t size);
+
+    char* buffer() { return buf_; }
+    size_t size() { return size_; }
+    size_t buffer_size() { return size_ + 2; }
+    int64_t mtime() { return mtime_; }  // in nanoseconds
+
+    // mtime of the file at path, or -1 if it can't be stat()ed
+    static int64_t mtime(const string& path);
+
+protected:
+    void release();
+
+protected:
+    char* buf_;
+    size_t size_;
+    int64_t mtime_;
+    bool mapped_;
+};
+
+/* SourceManager owns the content of the files being compiled and
+ * gives each of them an id, so that a Location is just a file id and
+ * a byte offset. Lines and columns are only worked out when somebody
+ * asks for them, from an index of the newlines that is built as far
+ * as needed. Ids are never reused, 0 means no file.
+ */
+class SourceManager {
+public:
+    static SourceManager& instance();
+
+    // returns the id of the loaded file, or 0 with errno set
+    uint32_t load(const string& path);
+
+    // a file with the given content, such as a buffer being edited
+    uint32_t add(const string& name, const char* text, size_t size);
+
+    // replaces the content of id, its locations refer to the new text
+    void update(uint32_t id, const char* text, size_t size);
+
+    // A copy of size bytes of id from base, with an id of its own so
+    // that it can be scanned by itself. Its locations are reported in
+    // id at base + offset, move_segment() follows edits before it.
+    uint32_t add_segment(uint32_t id, uint32_t base, size_t size);
+    void move_segment(uint32_t id, uint32_t base);
+
+    // the content, valid until remove(id)
+    SourceFile* file(uint32_t id);
+
+    // forgets the file, locations in it show up as unknown afterwards
+    void remove(uint32_t id);
+
+    string name(uint32_t id);
+
+    // 1-based, 0 for an unknown file
+    void position(uint32_t id, uint32_t offset, int* line, int* column);
+
+protected:
+    SourceManager() {}
+
+    struct Entry {
+        string name_;
+        SourceFile file_;
+        uint32_t parent_;   // of a segment, 0 for a file
+        uint32_t base_;
+        // offsets of the line starts seen so far, and how far the
+        // content has been scanned for them
+        vector<uint32_t> lines_;
+        uint32_t indexed_;
+    };
+
+    uint32_t add_entry(Entry* e);
+
+    mutex mutex_;
+    vector<Entry*> entries_;   // by id - 1
+};
+
+/* Range of the parser's symbols, in bytes of the file being parsed.
+ * See api.location.type in parser.y.
+ */
+struct SourceRange {
+    SourceRange() : begin(0), end(0) {}
+
+    uint32_t begin;
+    uint32_t end;
+};
+
+} // namespace cbc
+
+#endif
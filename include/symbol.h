@@ -0,0 +1,71 @@
+#ifndef SYMBOL_H_
+#define SYMBOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+namespace cbc {
+
+/* An interned identifier. Every distinct name is stored once in a
+ * process-wide table and is known by its 32-bit id from then on, so
+ * comparing and hashing names are integer operations. Symbols never
+ * go away, the table only grows; id 0 is the empty name. Interning
+ * more than capacity() names throws, long running processes must
+ * watch count() (see Server).
+ */
+class Symbol {
+public:
+    Symbol() : id_(0) {}
+    explicit Symbol(const string& s) : id_(intern(s.data(), s.size())) {}
+    Symbol(const char* p, size_t n) : id_(intern(p, n)) {}
+
+    uint32_t id() const { return id_; }
+    const string& str() const;
+    const char* c_str() const { return str().c_str(); }
+    size_t size() const { return str().size(); }
+    bool empty() const { return id_ == 0; }
+
+    bool operator==(Symbol other) const { return id_ == other.id_; }
+    bool operator!=(Symbol other) const { return id_ != other.id_; }
+    // by id, not alphabetical
+    bool operator<(Symbol other) const { return id_ < other.id_; }
+
+    // number of distinct symbols
+    static size_t count();
+    // most distinct symbols a process can have
+    static size_t capacity();
+
+private:
+    static uint32_t intern(const char* p, size_t n);
+
+private:
+    uint32_t id_;
+};
+
+inline string operator+(const string& s, Symbol sym) { return s + sym.str(); }
+inline string operator+(const char* s, Symbol sym) { return s + sym.str(); }
+inline string operator+(Symbol sym, const string& s) { return sym.str() + s; }
+inline string operator+(Symbol sym, const char* s) { return sym.str() + s; }
+
+inline ostream& operator<<(ostream& os, Symbol sym)
+{
+    return os << sym.str();
+}
+
+} // namespace cbc
+
+namespace std {
+
+template<>
+struct hash<cbc::Symbol> {
+    size_t operator()(cbc::Symbol sym) const { return sym.id(); }
+};
+
+} // namespace std
+
+#endif
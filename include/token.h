@@ -1,50 +1,58 @@
 #ifndef TOKEN_H_
 #define TOKEN_H_
 
+#include <cstdint>
 #include <string>
 
+#include "symbol.h"
+
 using namespace std;
 
 namespace cbc {
 
+/* A token refers to its text in the buffer being scanned, which lives
+ * as long as the parse, so making one allocates nothing. Identifiers
+ * and type names also carry their interned name in symbol_, string
+ * and character literals their decoded value in value_.
+ */
 class Token {
 public:
-    Token() : 
-        kind_(0), image_(""), 
-        begin_line_(0),
-        begin_column_(0), 
-        end_line_(0), 
-        end_column_(0) {}
-
-    Token(int kind, const string& image) : 
-        kind_(kind), image_(image),
-        begin_line_(0), 
-        begin_column_(0), 
-        end_line_(0), end_column_(0) {}
-
-    Token(const Token& token) : 
-        kind_(token.kind_), image_(token.image_),
-        begin_line_(token.begin_line_), 
-        begin_column_(token.begin_column_), 
-        end_line_(token.end_line_), 
-        end_column_(token.end_column_) {}
-       
-    Token(Token&& token) : 
-        kind_(token.kind_), image_(token.image_),
-        begin_line_(token.begin_line_), 
-        begin_column_(token.begin_column_), 
-        end_line_(token.end_line_), 
-        end_column_(token.end_column_) {}
+    Token() :
+        kind_(0), offset_(0), image_(nullptr), length_(0) {}
+
+    Token(int kind) :
+        kind_(kind), offset_(0), image_(nullptr), length_(0) {}
+
+    Token(int kind, Symbol symbol) :
+        kind_(kind), offset_(0), image_(nullptr), length_(0),
+        symbol_(symbol) {}
+
+    Token(int kind, string&& value) :
+        kind_(kind), offset_(0), image_(nullptr), length_(0),
+        value_(move(value)) {}
+
+    Token(const Token& token) :
+        kind_(token.kind_), offset_(token.offset_),
+        image_(token.image_), length_(token.length_),
+        symbol_(token.symbol_), value_(token.value_) {}
+
+    Token(Token&& token) :
+        kind_(token.kind_), offset_(token.offset_),
+        image_(token.image_), length_(token.length_),
+        symbol_(token.symbol_), value_(move(token.value_)) {}
+
+    // the text as written in the source
+    string image() const { return string(image_, length_); }
 
 public:
     int kind_;
-    int begin_line_;
-    int begin_column_;
-    int end_line_;
-    int end_column_;
-    string image_;
+    uint32_t offset_;   // in the file, see Location
+    const char* image_; // not NUL-terminated
+    uint32_t length_;
+    Symbol symbol_;
+    string value_;
 };
 
 } // namespace cbc
 
-#endif
\ No newline at end of file
+#endif
@@ -2,8 +2,10 @@
 #define TYPE_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "casting.h"
 #include "object.h"
 #include "util.h"
 
@@ -25,7 +27,22 @@ class TypeTable;
 class Type : public Object {
 public:
     static const long kSizeUnknown = -1;
+
+    // the class of a type, see casting.h
+    enum Kind {
+        kVoid,
+        kInteger,
+        kPointer,
+        kStruct,
+        kUnion,
+        kUser,
+        kArray,
+        kFunction,
+    };
+
+    Type(Kind kind) : kind_(kind) {}
     virtual ~Type() {}
+    Kind kind() const { return kind_; }
     virtual long size() { return 0;};
     virtual long alloc_size() { return size(); }
     virtual long alignment() { return alloc_size(); }
@@ -50,41 +67,69 @@ public:
     virtual string to_string() const { return ""; }
     virtual Type* base_type() { throw "base_type() called for undereferable type"; }
 
-    template<typename Derived>
-    bool instanceof() {
-        return dynamic_cast<Derived*>(this) != nullptr;
-    }
+    // UserType answers for its real type
+    virtual CompositeType* get_composite_type();
+    virtual PointerType* get_pointer_type();
+    virtual FunctionType* get_function_type();
+    virtual IntegerType* get_integer_type();
+    virtual StructType* get_struct_type();
+    virtual UnionType* get_union_type();
+    virtual ArrayType* get_array_type();
 
-    CompositeType* get_composite_type();
-    PointerType* get_pointer_type();
-    FunctionType* get_function_type();
-    IntegerType* get_integer_type();
-    StructType* get_struct_type();
-    UnionType* get_union_type();
-    ArrayType* get_array_type();
+protected:
+    const Kind kind_;
 };
 
+/* A TypeRef names a type as written, and is the key TypeTable finds
+ * the Type by. Its hash is worked out from its structure when it is
+ * made, from the hashes of the refs it is built of, so looking it up
+ * renders nothing; refs that are equals() hash the same. The parts of
+ * a ref must not change once it is made.
+ */
 class TypeRef : public Object {
 public:
-    TypeRef() {}
-    TypeRef(const Location& loc) : loc_(loc) {}
-
-    template<typename Derived>
-    bool instanceof() {
-        return dynamic_cast<Derived*>(this) != nullptr;
-    }
+    // the class of a ref, see casting.h
+    enum Kind {
+        kVoid,
+        kInteger,
+        kPointer,
+        kStruct,
+        kUnion,
+        kUser,
+        kArray,
+        kFunction,
+    };
+
+    TypeRef(Kind kind) : kind_(kind), hash_(kind) {}
+    TypeRef(Kind kind, const Location& loc) :
+        kind_(kind), loc_(loc), hash_(kind) {}
 
     virtual ~TypeRef() {}
+    Kind kind() const { return kind_; }
     Location location() { return loc_; }
     virtual string to_string() const { return ""; }
 
+    size_t hash() const { return hash_; }
+
+    // by structure, refs of the same type are equal wherever they are
+    bool equals(TypeRef* other);
+    bool equals(Object* other);
+
+protected:
+    static size_t hash_combine(size_t h, size_t v) {
+        return h ^ (v + 0x9e3779b9 + (h << 6) + (h >> 2));
+    }
+
 protected:
+    const Kind kind_;
     Location loc_;
+    size_t hash_;   // the kind, and the parts mixed in by each kind
 };
 
 class VoidType : public Type {
 public:
-    VoidType() {}
+    VoidType() : Type(kVoid) {}
+    static bool classof(const Type* t) { return t->kind() == kVoid; }
     bool is_void() { return true; }
     long size() { return 1; }
     bool equals(Object* other);
@@ -96,26 +141,29 @@ public:
 
 class VoidTypeRef : public TypeRef {
 public:
-    VoidTypeRef() {}
-    VoidTypeRef(const Location &loc) : TypeRef(loc) {}
+    VoidTypeRef() : TypeRef(kVoid) {}
+    VoidTypeRef(const Location &loc) : TypeRef(kVoid, loc) {}
+    static bool classof(const TypeRef* ref) { return ref->kind() == kVoid; }
     bool is_void() { return true; }
-    bool equals(Object* other);
     string to_string() const { return "void"; }
 };
 
 class IntegerTypeRef : public TypeRef {
 public:
-    IntegerTypeRef(const string& name) : name_(name), TypeRef(Location()) {}
+    IntegerTypeRef(const string& name) : TypeRef(kInteger), name_(name) {
+        hash_ = hash_combine(hash_, std::hash<string>()(name_));
+    }
 
     IntegerTypeRef(const string& name, const Location& loc) :
-        name_(name), TypeRef(loc) {}
+        TypeRef(kInteger, loc), name_(name) {
+        hash_ = hash_combine(hash_, std::hash<string>()(name_));
+    }
     
     ~IntegerTypeRef() {}
 
-    string name() { return name_; }
+    static bool classof(const TypeRef* ref) { return ref->kind() == kInteger; }
+    const string& name() { return name_; }
     string to_string() const { return name_; }
-    
-    bool equals(Object* other);
 
     static IntegerTypeRef* char_ref(const Location& loc);
     static IntegerTypeRef* char_ref();
@@ -141,6 +189,7 @@ protected:
 class IntegerType : public Type {
 public:
     IntegerType(long size, bool is_signed, const string& name);
+    static bool classof(const Type* t) { return t->kind() == kInteger; }
     bool is_same_type(Type* other);
 
     bool is_integer() { return true; }
@@ -162,11 +211,15 @@ protected:
 
 class NamedType : public Type {
 public:
-    NamedType(const string& name, const Location& loc);
-    string name() { return name_; }
+    NamedType(Kind kind, Symbol name, const Location& loc);
+    static bool classof(const Type* t) {
+        return t->kind() == kStruct || t->kind() == kUnion ||
+            t->kind() == kUser;
+    }
+    Symbol name() { return name_; }
     Location location() { return loc_; }
 protected:
-    string name_;
+    Symbol name_;
     Location loc_;
 };
 
@@ -175,8 +228,8 @@ public:
     PointerTypeRef(TypeRef* base);
     ~PointerTypeRef();
 
+    static bool classof(const TypeRef* ref) { return ref->kind() == kPointer; }
     bool is_pointer() { return true; }
-    bool equals(Object* other);
 
     TypeRef* base_type();
     string to_string() const;
@@ -189,6 +242,7 @@ class PointerType : public Type {
 public:
     PointerType(long size, Type* base);
     ~PointerType();
+    static bool classof(const Type* t) { return t->kind() == kPointer; }
     bool is_pointer() { return true; }
     bool is_scalar() { return true; }
     bool is_signed() { return false; }
@@ -208,42 +262,55 @@ protected:
 
 class CompositeType : public NamedType {
 public:    
-    CompositeType(const string& name, 
+    CompositeType(Kind kind, Symbol name, 
         vector<Slot*>&& membs, const Location& loc);
 
     ~CompositeType();
 
+    static bool classof(const Type* t) {
+        return t->kind() == kStruct || t->kind() == kUnion;
+    }
+
     bool is_composite_type() { return true; }
     bool is_same_type(Type* other);
     bool is_compatible(Type* target);
     bool is_castable_to(Type* target);
     long size();
-    long alignmemt();
+    long alignment();
 
-    vector<Slot*> members();
-    vector<Type*> member_types();
-    bool has_member(const string& name);
-    Type* member_type(const string& name);
-    long member_offset(const string& name);
+    // members are borrowed, don't dec_ref() them
+    const vector<Slot*>& members() { return members_; }
+    bool has_member(Symbol name);
+    Type* member_type(Symbol name);
+    long member_offset(Symbol name);
+
+    // Lays out the members once, for the sizes of the table the
+    // member types come from. TypeTable::semantic_check() does it for
+    // all the types of the table, size() and the like on demand.
+    void layout();
 
 protected:
-    // method should be "is_same_type/is_compatible/is_castable_to"
-    bool compare_member_types(Type* other, const string& method);
-    bool compare_types_by(const string& method, Type* t, Type* tt);
-    virtual void compute_offsets() {};
-    Slot* fetch(const string& name);
-    Slot* get(const string& name);
+    // method is one of is_same_type, is_compatible and is_castable_to
+    bool compare_member_types(Type* other, bool (Type::*method)(Type*));
+    // sets the offsets of the members, cached_size_ and cached_align_
+    virtual void compute_offsets() = 0;
+    Slot* fetch(Symbol name);
+    Slot* get(Symbol name);
 
 protected:
     vector<Slot*> members_;
+    // the index in members_ by name, the first one if it is duplicated
+    unordered_map<Symbol, size_t> index_;
     long cached_size_;
     long cached_align_;
+    bool in_layout_;
     bool is_recursive_checked_;
 };
 
 class StructType : public CompositeType {
 public:
-    StructType(const string& name, vector<Slot*>&& membs, const Location& loc);
+    StructType(Symbol name, vector<Slot*>&& membs, const Location& loc);
+    static bool classof(const Type* t) { return t->kind() == kStruct; }
     bool is_struct() { return true; }
     string to_string() const { return "struct " + name_; }
     bool is_same_type(Type* other);
@@ -252,20 +319,21 @@ public:
 
 class StructTypeRef : public TypeRef {
 public:
-    StructTypeRef(const string& name);
-    StructTypeRef(const Location& loc, const string& name);
+    StructTypeRef(Symbol name);
+    StructTypeRef(const Location& loc, Symbol name);
+    static bool classof(const TypeRef* ref) { return ref->kind() == kStruct; }
     bool is_struct() { return true; }
-    string name() { return name_; }
+    Symbol name() { return name_; }
     string to_string() const { return "struct " + name_; }
-    bool equals(Object* other);
 
 protected:
-    string name_;
+    Symbol name_;
 };
 
 class UnionType : public CompositeType {
 public:
-    UnionType(const string& name, vector<Slot*>&& membs, const Location& loc);
+    UnionType(Symbol name, vector<Slot*>&& membs, const Location& loc);
+    static bool classof(const Type* t) { return t->kind() == kUnion; }
     bool is_union() { return true; }
     bool is_same_type(Type* other);
     void compute_offsets();
@@ -274,36 +342,38 @@ public:
 
 class UnionTypeRef : public TypeRef {
 public:
-    UnionTypeRef(const string& name);
-    UnionTypeRef(const Location& loc, const string& name);
+    UnionTypeRef(Symbol name);
+    UnionTypeRef(const Location& loc, Symbol name);
+    static bool classof(const TypeRef* ref) { return ref->kind() == kUnion; }
     bool is_union() { return true; }
-    bool equals(Object* other);
-    string name() { return name_; }
+    Symbol name() { return name_; }
     string to_string() const { return "union " + name_; }
 
 protected:
-    string name_;
+    Symbol name_;
 };
 
 class UserTypeRef : public TypeRef {
 public:
-    UserTypeRef(const string& name);
-    UserTypeRef(const Location& loc, const string& name);
+    UserTypeRef(Symbol name);
+    UserTypeRef(const Location& loc, Symbol name);
+    static bool classof(const TypeRef* ref) { return ref->kind() == kUser; }
     bool is_user_type() { return true; }
-    bool equals(Object* other);
-    string name() { return name_; }
-    string to_string() const { return name_; }
+    Symbol name() { return name_; }
+    string to_string() const { return name_.str(); }
 
 protected:
-    string name_;
+    Symbol name_;
 };
 
 
 class UserType : public NamedType {
 public:
-    UserType(const string& name, TypeNode* real, const Location& loc);
+    UserType(Symbol name, TypeNode* real, const Location& loc);
     ~UserType();
 
+    static bool classof(const Type* t) { return t->kind() == kUser; }
+
     Type* real_type();
     long size() { return real_type()->size(); }
     long alloc_size() { return real_type()->alloc_size(); }
@@ -326,8 +396,8 @@ public:
 
     bool is_same_type(Type* other) { return real_type()->is_same_type(other); }
     bool is_compatible(Type* other) { return real_type()->is_compatible(other); }
-    bool is_castableTo(Type* other) { return real_type()->is_castable_to(other); }
-    string to_string() const { return name_; }
+    bool is_castable_to(Type* other) { return real_type()->is_castable_to(other); }
+    string to_string() const { return name_.str(); }
 
     CompositeType* get_composite_type() { return real_type()->get_composite_type(); }
     PointerType* get_pointer_type() { return real_type()->get_pointer_type(); }
@@ -347,8 +417,8 @@ public:
     ArrayTypeRef(TypeRef* base, long length);
     ~ArrayTypeRef();
 
+    static bool classof(const TypeRef* ref) { return ref->kind() == kArray; }
     bool is_array() { return true; }
-    bool equals(Object* other);
 
     TypeRef* base_type() { return base_type_; }
     long length() { return length_; }
@@ -367,6 +437,8 @@ public:
     ArrayType(Type* base_type, long length, long pointerSize);
     ~ArrayType();
 
+    static bool classof(const Type* t) { return t->kind() == kArray; }
+
     bool is_array() { return true; }
     bool is_allocated_array();
     Type* base_type() { return base_type_; }
@@ -475,9 +547,8 @@ public:
     FunctionTypeRef(TypeRef* return_type, ParamTypeRefs* params);
     ~FunctionTypeRef();
 
+    static bool classof(const TypeRef* ref) { return ref->kind() == kFunction; }
     bool is_function() { return true; }
-    bool equals(Object* other);
-    bool equals(FunctionTypeRef* other);
     TypeRef* return_type() { return return_type_; }
     ParamTypeRefs* params() { return params_;}
     string to_string() const;
@@ -492,6 +563,8 @@ public:
     FunctionType(Type* ret, ParamTypes* partypes);
     ~FunctionType();
 
+    static bool classof(const Type* t) { return t->kind() == kFunction; }
+
     bool is_function() { return true; }
     bool is_callable() { return true; }
     bool is_same_type(Type* type);
@@ -2,27 +2,57 @@
 #define TYPE_TABLE_H_
 
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "ref_ptr.h"
 #include "type.h"
 
 namespace cbc {
 
 using namespace std;
 
+// by structure, see TypeRef::hash()
 class TypeRefHash {
 public:
     size_t operator()(const TypeRef* ref) const {
-        return hash<string>()(ref->to_string());
+        return ref->hash();
     }
 };
 
 class TypeRefEqual {
 public:
     bool operator()(const TypeRef* r1, const TypeRef* r2) const {
-        return ((TypeRef*)r1)->equals((Object*)r2);
+        // equals() compares the hashes first
+        return ((TypeRef*)r1)->equals(const_cast<TypeRef*>(r2));
     }
 };
 
+// for keys made of types, which are compared by identity
+class TypeKeyHash {
+public:
+    template<typename T>
+    size_t operator()(const pair<Type*, T>& p) const {
+        return hash<Type*>()(p.first) * 31 + hash<T>()(p.second);
+    }
+
+    size_t operator()(const vector<Type*>& v) const {
+        size_t h = v.size();
+        for (auto* t : v) {
+            h = h * 31 + hash<Type*>()(t);
+        }
+        return h;
+    }
+};
+
+/* TypeTable resolves TypeRefs to Types. There is one Type for each
+ * distinct pointer, array and function type: they are made of the
+ * types of the table, which are unique themselves, so two of them
+ * are the same type if they are the same object. Only a typedef name
+ * makes a type of its own that is the same as another (see UserType),
+ * then is_same_type() has to look further. The relations between the
+ * types are remembered, see is_compatible() and is_castable_to().
+ */
 class TypeTable {
 public:
     ~TypeTable();
@@ -38,15 +68,27 @@ public:
 
     bool is_defined(TypeRef* ref);
     void put(TypeRef* ref, Type* t);
+    // the table keeps every type it resolves, these are borrowed
     Type* get(TypeRef* ref);
     Type* get_param_type(TypeRef* ref);
-    PointerType* pointer_to(Type* base_type);
+    RefPtr<PointerType> pointer_to(Type* base_type);
+    // length is -1 if it isn't given
+    RefPtr<ArrayType> array_of(Type* base_type, long length);
+    RefPtr<FunctionType> function_of(Type* return_type, ParamTypes* params);
+
+    // t->is_compatible(other) and t->is_castable_to(other), worked
+    // out once for each pair
+    bool is_compatible(Type* t, Type* other);
+    bool is_castable_to(Type* t, Type* other);
 
     int int_size() { return int_size_; }
     int long_size() { return long_size_; }
     int pointer_size() { return pointer_size_; }
     int max_int_size() { return pointer_size_; }
-    Type* ptr_diff_type() { return get(ptr_diff_type_ref()); }
+    Type* ptr_diff_type() {
+        auto ref = RefPtr<TypeRef>::adopt(ptr_diff_type_ref());
+        return get(ref.get());
+    }
 
     // returns a IntegerTypeRef whose size is equals to pointer.
     TypeRef* ptr_diff_type_ref() { return new IntegerTypeRef(ptr_diff_type_name()); }
@@ -56,21 +98,23 @@ public:
     Type* signed_stack_type() { return signed_long(); }
     Type* unsigned_stack_type() { return unsigned_long(); }
     vector<Type*> types();
-    VoidType* void_type();
-    IntegerType* signed_char();
-    IntegerType* signed_short();
-    IntegerType* signed_int();
-    IntegerType* signed_long();
-    IntegerType* unsigned_char();
-    IntegerType* unsigned_short();
-    IntegerType* unsigned_int();
-    IntegerType* unsigned_long();
+    VoidType* void_type() { return void_type_; }
+    IntegerType* signed_char() { return signed_char_; }
+    IntegerType* signed_short() { return signed_short_; }
+    IntegerType* signed_int() { return signed_int_; }
+    IntegerType* signed_long() { return signed_long_; }
+    IntegerType* unsigned_char() { return unsigned_char_; }
+    IntegerType* unsigned_short() { return unsigned_short_; }
+    IntegerType* unsigned_int() { return unsigned_int_; }
+    IntegerType* unsigned_long() { return unsigned_long_; }
 
     void semantic_check(ErrorHandler* h);
     void check_void_members(CompositeType* t, ErrorHandler* h);
     void check_void_members(ArrayType* t, ErrorHandler* h);
     void check_duplicated_members(CompositeType* t, ErrorHandler* h);
-    void check_recursive_definition(Type* t, ErrorHandler* h);
+    // reports each cycle of types holding each other by value
+    void check_recursive_definitions(const vector<Type*>& types,
+                                     ErrorHandler* h);
 
 protected:
     TypeTable(int int_size, int long_size, int ptr_size);
@@ -81,6 +125,29 @@ protected:
     int long_size_;
     int pointer_size_;
     unordered_map<TypeRef*, Type*, TypeRefHash, TypeRefEqual> table_;
+
+    // the builtin types, held by table_
+    VoidType* void_type_;
+    IntegerType* signed_char_;
+    IntegerType* signed_short_;
+    IntegerType* signed_int_;
+    IntegerType* signed_long_;
+    IntegerType* unsigned_char_;
+    IntegerType* unsigned_short_;
+    IntegerType* unsigned_int_;
+    IntegerType* unsigned_long_;
+
+    // the canonical types by what they are made of, the table holds a
+    // reference of each, and they hold the types of their keys
+    unordered_map<Type*, PointerType*> pointers_;
+    unordered_map<pair<Type*, long>, ArrayType*, TypeKeyHash> arrays_;
+    // the return type, the parameter types, and nullptr for varargs
+    unordered_map<vector<Type*>, FunctionType*, TypeKeyHash> functions_;
+
+    // holds a reference of both types of each pair
+    typedef unordered_map<pair<Type*, Type*>, bool, TypeKeyHash> Relation;
+    Relation compatible_;
+    Relation castable_;
 };
 
 }
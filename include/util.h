@@ -1,6 +1,7 @@
 #ifndef UTIL_H_
 #define UTIL_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <ostream>
@@ -15,22 +16,22 @@ class Type;
 class TypeRef;
 class TypeNode;
 
+/* A position in a source file, see SourceManager. */
 class Location {
 public:
-    Location() {}
-    Location(const Token& tok);
-    Location(const string& src, const Token& tok);
-   
-    int lineno() { return tok_.begin_line_; }
-    int column() { return tok_.begin_column_; }
-    string source_name() { return src_; }
-    string to_string() const { return (src_.size() ? src_ : "(unknown)") + \
-        ":" + std::to_string(tok_.begin_line_) + \
-        "," + std::to_string(tok_.begin_column_); }
+    Location() : file_(0), offset_(0) {}
+    Location(uint32_t file, uint32_t offset) : file_(file), offset_(offset) {}
+
+    uint32_t file() const { return file_; }
+    uint32_t offset() const { return offset_; }
+    int lineno() const;
+    int column() const;
+    string source_name() const;
+    string to_string() const;
 
 protected:
-    string src_;
-    Token tok_;
+    uint32_t file_;
+    uint32_t offset_;
 };
 
 class Dumper {
@@ -44,6 +45,8 @@ public:
     void print_member(const string& name, bool b);
     void print_member(const string& name, const string& str);
     void print_member(const string& name, const string& str, bool is_resolved);
+    void print_member(const string& name, Symbol sym);
+    void print_member(const string& name, Symbol sym, bool is_resolved);
     void print_member(const string& name, TypeRef* ref);
     void print_member(const string& name, Type* type);
     void print_member(const string& name, TypeNode* n);
@@ -94,6 +97,10 @@ public:
     virtual void dump(Dumper& dumper) = 0;
 };
 
+/* Collects the diagnostics of a compilation, so that the parser can
+ * go on after an error and report the others too. Once limit_ errors
+ * have been reported, error() throws a string to give up.
+ */
 class ErrorHandler {
 public:
     ErrorHandler(const string& progid);
@@ -106,12 +113,18 @@ public:
     void warn(const Location& loc, const string& msg);
 
     bool error_occured() { return nerror_; }
+    long errors() { return nerror_; }
+    long warnings() { return nwarning_; }
+
+    // 0 for no limit
+    void set_limit(long limit) { limit_ = limit; }
 
 protected:
     string program_id_;
     ostream& os_;
     long nerror_;
     long nwarning_;
+    long limit_;
 };
 
 } // namespace cbc
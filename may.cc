@@ -2,19 +2,14 @@
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <iostream>
 #include <string>
-#include <set>
+#include <vector>
 
-#include <fcntl.h>
-
-#include "ast.h"
-#include "util.h"
-#include "option.h"
-#include "loader.h"
-
-#include "parser/lexer.hh"
-#include "parser/parser.hh"
+#include "compiler.h"
+#include "server.h"
 
 using namespace std;
 
@@ -23,105 +18,152 @@ static struct option long_options[] = {
     {"help", no_argument, 0, 'h'},
     {"dump-ast", no_argument, 0, 'a'},
     {"dump-tokens", no_argument, 0, 't'},
+    {"check-types", no_argument, 0, 'T'},
+    {"jobs", required_argument, 0, 'j'},
+    {"import-cache", required_argument, 0, 'c'},
+    {"mem-report", no_argument, 0, 'm'},
+    {"lazy-bodies", no_argument, 0, 'l'},
+    {"syntax-only", no_argument, 0, 'S'},
+    {"incremental", no_argument, 0, 'i'},
+    {"max-errors", required_argument, 0, 'e'},
+    {"server", required_argument, 0, 's'},
+    {"client", required_argument, 0, 'C'},
     {0, 0, 0, 0}
 };
 
-void usage(const char* name)
+int usage(const char* name, ostream& os)
 {
-    printf("usage: %s [options] file...\n", name);
-    printf("global options:\n");
-    printf("  --dump-tokens    dump tokens and quit.\n");
-    printf("  --dump-ast       dump ast and quit.\n");
-    exit(1);
+    os << "usage: " << name << " [options] file...\n";
+    os << "global options:\n";
+    os << "  --dump-tokens    dump tokens and quit.\n";
+    os << "  --dump-ast       dump ast and quit.\n";
+    os << "  --check-types    check the types and print the struct layouts.\n";
+    os << "  -j, --jobs N     compile N files in parallel.\n";
+    os << "  --import-cache DIR\n";
+    os << "                   keep precompiled headers in DIR.\n";
+    os << "  --mem-report     print memory used by each file.\n";
+    os << "  --lazy-bodies    parse function bodies only when they are used.\n";
+    os << "  --syntax-only    check the syntax and print bytes/sec, build no AST.\n";
+    os << "  --incremental    parse each definition again through edits, for testing.\n";
+    os << "  --max-errors N   stop a file after N errors, 0 for no limit.\n";
+    os << "  --server SOCKET  serve compilations on SOCKET.\n";
+    os << "  --client SOCKET  compile on the server at SOCKET if there is one.\n";
+    return 1;
 }
 
-void cbc_dump_token(yyscan_t lexer)
-{
-    int c = 0;
-    do {
-        parser::Parser::location_type loc;
-        parser::Parser::semantic_type val;
-        c = yylex(&val, &loc, lexer);
-        auto tok = val.as<Token>();
-        printf("token: %-15s at line: %d column: %d\n",
-            tok.image_.c_str(), tok.begin_line_, tok.begin_column_);
-    } while (c != 0);
-}
-
-int main(int argc, char *argv[])
+/* Runs a command line, either the one of this process or one sent by
+ * a client. A server ignores --server and --client in the requests.
+ */
+int run(const vector<string>& args, ostream& os, bool remote)
 {
     int c;
     int opt_index = 0;
-    bool dump_ast = false;
-    bool dump_expr = false;
-    bool dump_stmt = false;
-    bool dump_token = false;
+    cbc::Compiler compiler;
+    string server;
+    string client;
+
+    // getopt wants a mutable argv
+    vector<string> copy(args);
+    vector<char*> argv;
+    for (auto& arg : copy) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    int argc = args.size();
 
-    while ((c = getopt_long(argc, argv, "hat", long_options, &opt_index)) != -1) {
+    optind = 0;     // restart scanning, also for GNU extensions
+    while ((c = getopt_long(argc, argv.data(), "hatj:", long_options, &opt_index)) != -1) {
         switch (c) {
         case -1:
             break;
         case 'h':
-            usage(argv[0]);
-            break;
+            return usage(argv[0], os);
         case 't':
-            dump_token = true;
+            compiler.dump_tokens_ = true;
             break;
         case 'a':
-            dump_ast = true;
+            compiler.dump_ast_ = true;
+            break;
+        case 'T':
+            compiler.check_types_ = true;
+            break;
+        case 'j':
+            compiler.jobs_ = atoi(optarg);
+            if (compiler.jobs_ <= 0) {
+                return usage(argv[0], os);
+            }
+            break;
+        case 'c':
+            if (!compiler.set_import_cache(optarg)) {
+                os << "can not use import cache " << optarg << ": "
+                   << strerror(errno) << endl;
+                return 1;
+            }
+            break;
+        case 'm':
+            compiler.mem_report_ = true;
+            break;
+        case 'l':
+            compiler.lazy_bodies_ = true;
+            break;
+        case 'S':
+            compiler.syntax_only_ = true;
+            break;
+        case 'i':
+            compiler.incremental_ = true;
+            break;
+        case 'e':
+            compiler.max_errors_ = atoi(optarg);
+            if (compiler.max_errors_ < 0) {
+                return usage(argv[0], os);
+            }
+            break;
+        case 's':
+            server = optarg;
+            break;
+        case 'C':
+            client = optarg;
             break;
+        default:
+            return usage(argv[0], os);
         }
     }
 
-    if (optind == argc) {
-        usage(argv[0]);
-    }
-
-    for (; argv[optind] != nullptr; ++optind) {
-        int fd = open(argv[optind], O_RDONLY);
-        if (fd < 0) {
-            fprintf(stderr, "can not open file %s\n", argv[optind]);
-            exit(1);
-        }
-        fprintf(stdout, "processing file %s\n", argv[optind]);
-
-        Option option;
-        yyscan_t lexer;
-        yylex_init(&lexer);
-        yyset_extra(&option, lexer);
-        option.src_ = argv[optind];
-        option.start_ = parser::Parser::token::COMPILE;
-
-        FILE* f = fdopen(fd, "r");
-        yyset_in(f, lexer);
- 
-        if (dump_token == true) {
-            cbc_dump_token(lexer);
-            fclose(f);
-            yylex_destroy(lexer);
-            continue;
+    if (!remote && !server.empty()) {
+        {
+            cbc::Server s(server, [](const vector<string>& args, ostream& os) {
+                return run(args, os, true);
+            });
+            if (s.run() != 0) {
+                os << "can not serve on " << server << ": "
+                   << strerror(errno) << endl;
+                return 1;
+            }
         }
+        // the symbol table is nearly full, run again in a new image
+        execv("/proc/self/exe", argv.data());
+        os << "can not restart server: " << strerror(errno) << endl;
+        return 1;
+    }
 
-        try {
-            parser::Parser parser(lexer);
-            int res = parser.parse();
-            if (res == 0) {   
-                cbc::AST* ast = option.ast_;
-                // AST will be destroyed when option is out of the current scope
-                if (dump_ast) {
-                    Dumper dumper(cout);
-                    ast->dump(dumper);
-                }
-                ast->dec_ref();
-            }
-        } catch (...) {
-            // printf("error: %s\n", e.c_str());
+    if (!remote && !client.empty()) {
+        int status = cbc::Server::forward(client, args, os);
+        if (status >= 0) {
+            return status;
         }
+        // no server, compile here
+    }
 
-        fclose(f);
-        close(fd);
-        yylex_destroy(lexer);
+    if (optind == argc) {
+        return usage(argv[0], os);
     }
-    return 0;
+
+    vector<string> files(args.begin() + optind, args.end());
+    return compiler.compile(files, os);
 }
 
+int main(int argc, char *argv[])
+{
+    vector<string> args(argv, argv + argc);
+    return run(args, cout, false);
+}
@@ -0,0 +1,150 @@
+#include "header_cache.h"
+#include "decl.h"
+#include "serialize.h"
+#include "source.h"
+#include "version.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace cbc {
+
+static const char kMagic[] = "MAYPCH";
+// reads back as another number on a host of the other byte order
+static const uint32_t kByteOrder = 0x01020304;
+static const uint32_t kFormatVersion = 3;
+
+// FNV-1a
+uint64_t HeaderCache::hash(const char* data, size_t size)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t HeaderCache::combine(uint64_t h, uint64_t v)
+{
+    return (h ^ v) * 1099511628211ULL + 0x9e3779b97f4a7c15ULL;
+}
+
+string HeaderCache::entry_path(const string& realpath)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.pch",
+             (unsigned long long)hash(realpath.data(), realpath.size()));
+    return dir_ + "/" + name;
+}
+
+static string resolve(const string& path)
+{
+    char buf[PATH_MAX];
+    if (!realpath(path.c_str(), buf)) {
+        return "";
+    }
+    return buf;
+}
+
+Declarations* HeaderCache::load(const string& path, uint32_t file,
+                                uint64_t hash, vector<string>* imports,
+                                vector<uint64_t>* import_keys)
+{
+    string real = resolve(path);
+    if (real.empty()) {
+        return nullptr;
+    }
+
+    SourceFile entry;
+    if (!entry.load(entry_path(real))) {
+        return nullptr;
+    }
+
+    try {
+        DeclReader reader(entry.buffer(), entry.size(), file);
+        if (reader.read_string() != kMagic ||
+                reader.read_u32() != kByteOrder ||
+                reader.read_u32() != kFormatVersion ||
+                reader.read_string() != MAY_VERSION ||
+                reader.read_string() != real ||
+                reader.read_u64() != hash) {
+            return nullptr;
+        }
+        uint32_t n = reader.read_u32();
+        vector<string> libids;
+        vector<uint64_t> keys;
+        for (uint32_t i = 0; i < n; ++i) {
+            libids.push_back(reader.read_string());
+            keys.push_back(reader.read_u64());
+        }
+        Declarations* decls = reader.read();
+        imports->swap(libids);
+        import_keys->swap(keys);
+        return decls;
+    } catch (const string&) {
+        // corrupted entry, it will be overwritten by the next store()
+        return nullptr;
+    }
+}
+
+void HeaderCache::store(const string& path, uint64_t hash,
+                        const vector<string>& imports,
+                        const vector<uint64_t>& import_keys,
+                        Declarations* own)
+{
+    string real = resolve(path);
+    if (real.empty()) {
+        return;
+    }
+
+    string data;
+    DeclWriter writer(data);
+    try {
+        writer.write_string(kMagic);
+        writer.write_u32(kByteOrder);
+        writer.write_u32(kFormatVersion);
+        writer.write_string(MAY_VERSION);
+        writer.write_string(real);
+        writer.write_u64(hash);
+        writer.write_u32(imports.size());
+        for (size_t i = 0; i < imports.size(); ++i) {
+            writer.write_string(imports[i]);
+            writer.write_u64(import_keys[i]);
+        }
+        writer.write(own);
+    } catch (const string&) {
+        return;
+    }
+
+    // write a temporary file and rename it, so that other processes
+    // never see a partially written entry
+    string entry = entry_path(real);
+    string tmp = entry + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        return;
+    }
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = write(fd, data.data() + n, data.size() - n);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            break;
+        }
+        n += w;
+    }
+    if (close(fd) < 0 || n != data.size() ||
+            rename(tmp.c_str(), entry.c_str()) < 0) {
+        unlink(tmp.c_str());
+    }
+}
+
+} // namespace cbc
@@ -1,9 +1,16 @@
 #include "loader.h"
+#include "arena.h"
 #include "decl.h"
+#include "front_end.h"
+#include "header_cache.h"
 #include "option.h"
+#include "source.h"
 
-#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <algorithm>
+#include <iostream>
 
 using namespace std;
 
@@ -12,16 +19,107 @@ using namespace std;
 
 namespace cbc {
 
-Loader::Loader() :
-    load_path_(Loader::default_load_path())
+ModuleRegistry& ModuleRegistry::instance()
+{
+    static ModuleRegistry registry;
+    return registry;
+}
+
+string ModuleRegistry::real_path(const string& path)
+{
+    char buf[PATH_MAX];
+    return realpath(path.c_str(), buf) ? string(buf) : path;
+}
+
+ModuleRegistry::~ModuleRegistry()
+{
+    collect();
+    for (auto &p : modules_) {
+        p.second.decls_->dec_ref();
+    }
+}
+
+Declarations* ModuleRegistry::get(const string& path)
+{
+    lock_guard<mutex> lock(mutex_);
+    auto it = modules_.find(path);
+    if (it == modules_.end()) {
+        return nullptr;
+    }
+    set<string> checked;
+    if (check_mtime_ && !is_fresh(path, checked)) {
+        dropped_.push_back(it->second);
+        modules_.erase(it);
+        return nullptr;
+    }
+    return it->second.decls_;
+}
+
+uint64_t ModuleRegistry::key(const string& path)
 {
+    lock_guard<mutex> lock(mutex_);
+    auto it = modules_.find(path);
+    return it == modules_.end() ? 0 : it->second.key_;
 }
 
-Loader::~Loader()
+Declarations* ModuleRegistry::put(const string& path, Declarations* decls,
+                                  uint32_t file, int64_t mtime,
+                                  const vector<string>& deps, uint64_t hash)
 {
-    for (auto &p : loaded_) {
-        p.second->dec_ref();
+    lock_guard<mutex> lock(mutex_);
+    uint64_t key = hash;
+    for (auto& dep : deps) {
+        auto d = modules_.find(dep);
+        key = HeaderCache::combine(key,
+                                   d == modules_.end() ? 0 : d->second.key_);
     }
+    auto it = modules_.find(path);
+    if (it != modules_.end()) {
+        if (it->second.mtime_ == mtime) {
+            // another thread won the race, drop our copy
+            decls->dec_ref();
+            SourceManager::instance().remove(file);
+            return it->second.decls_;
+        }
+        dropped_.push_back(it->second);
+    }
+    modules_[path] = Module{decls, file, mtime, deps, key};
+    return decls;
+}
+
+void ModuleRegistry::collect()
+{
+    lock_guard<mutex> lock(mutex_);
+    for (auto& m : dropped_) {
+        m.decls_->dec_ref();
+        SourceManager::instance().remove(m.file_);
+    }
+    dropped_.clear();
+}
+
+// mutex_ must be held
+bool ModuleRegistry::is_fresh(const string& path, set<string>& checked)
+{
+    if (!checked.insert(path).second) {
+        return true;
+    }
+    auto it = modules_.find(path);
+    if (it == modules_.end() ||
+            SourceFile::mtime(path) != it->second.mtime_) {
+        return false;
+    }
+    for (auto& dep : it->second.deps_) {
+        if (!is_fresh(dep, checked)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Loader::Loader() :
+    load_path_(Loader::default_load_path()),
+    header_cache_(nullptr), os_(&cout)
+{
 }
 
 vector<string> Loader::default_load_path()
@@ -39,58 +137,157 @@ void Loader::add_load_path(const string& path)
 }
 
 Declarations* Loader::load_library(const string& libid) {
+    // imports outlive the file being compiled, keep them off its arena
+    Arena::Scope scope(nullptr);
+
     if (loading_.end() != find_if(loading_.begin(), loading_.end(), 
             [&libid](const string& name) -> bool {return libid == name; })) {
         throw string("recursive import from ") + loading_.back() + ": " + libid;
     }
 
+    FrontEnd::Lease front_end;
+    Option& option = front_end->option();
+    option.src_ = search_library(libid);
+    // src_ names the header in messages, the registry knows it by this
+    string path = ModuleRegistry::real_path(option.src_);
+    Declarations* decls = ModuleRegistry::instance().get(path);
+    if (decls) {
+        // already loaded by this or another file
+        return decls;
+    }
+
+    // the file is kept as long as its declarations, for their locations
+    SourceManager& sm = SourceManager::instance();
+    option.file_ = sm.load(option.src_);
+    if (!option.file_) {
+        throw option.src_ + ": " + strerror(errno);
+    }
+    SourceFile* source = sm.file(option.file_);
+
     loading_.push_back(libid);   // stop recursive import
 
-    auto it = loaded_.find(libid);
-    if (it != loaded_.end()) {
-        // Already loaded import file.  Returns cached declarations.
-        return it->second;
+    uint64_t hash = HeaderCache::hash(source->buffer(), source->size());
+    if (header_cache_) {
+        try {
+            decls = load_cached(option.src_, option.file_, hash,
+                                &option.imports_);
+        } catch (...) {
+            loading_.pop_back();
+            sm.remove(option.file_);
+            throw;
+        }
+        if (decls) {
+            loading_.pop_back();
+            return publish(path, decls, option.file_,
+                           source->mtime(), hash, option.imports_);
+        }
     }
 
-    Option option;
-    yyscan_t lexer;
-    yylex_init(&lexer);
-    yyset_extra(&option, lexer);
-    
-    int fd;
-    option.src_ = search_library(libid, &fd);
+    option.os_ = os_;
+    ErrorHandler errors("may", *os_);
+    option.errors_ = &errors;
     option.start_ = parser::Parser::token::DECLARE;
+    option.loader_ = this;
+    option.text_ = source->buffer();
+    ConstantTable constants;
+    option.constants_ = &constants;
+
+    front_end->scan(source);
+    int res;
+    try {
+        res = front_end->parse();
+    } catch (...) {
+        loading_.pop_back();
+        sm.remove(option.file_);
+        throw;
+    }
+    loading_.pop_back();
 
-    FILE* f = fdopen(fd, "r");
-    yyset_in(f, lexer);
+    if (res != 0 || errors.error_occured()) {
+        if (option.own_decl_) {
+            option.own_decl_->dec_ref();
+            option.decl_->dec_ref();
+        }
+        sm.remove(option.file_);
+        throw string("failed to load library: ") + libid;
+    }
 
-    parser::Parser parser(lexer);
-    int res = parser.parse();
-    if (res != 0) {
-        fclose(f);
-        close(fd);
-        yylex_destroy(lexer);
-        exit(1);
+    if (option.own_decl_) {
+        if (header_cache_) {
+            header_cache_->store(option.src_, hash, option.imports_,
+                                 import_keys(option.imports_),
+                                 option.own_decl_);
+        }
+        option.own_decl_->dec_ref();
     }
 
     // option won't delete anything
-    auto* decls = option.decl_;
-    loaded_[libid] = decls;
-    loading_.pop_back();
-    fclose(f);
-    close(fd);
-    yylex_destroy(lexer);
+    return publish(path, option.decl_, option.file_,
+                   source->mtime(), hash, option.imports_);
+}
+
+// Rebuilds the declarations of a header from its cache entry, the
+// headers it imports are loaded as if they had been parsed. The entry
+// is stale if they declare other types than when it was stored: they
+// decide which names the header's parse took for types.
+Declarations* Loader::load_cached(const string& path, uint32_t file,
+                                  uint64_t hash, vector<string>* imports)
+{
+    vector<uint64_t> keys;
+    Declarations* decls = header_cache_->load(path, file, hash, imports,
+                                              &keys);
+    if (!decls) {
+        return nullptr;
+    }
+    try {
+        for (auto& libid : *imports) {
+            decls->add(load_library(libid));
+        }
+        if (import_keys(*imports) != keys) {
+            decls->dec_ref();
+            imports->clear();
+            return nullptr;
+        }
+    } catch (...) {
+        decls->dec_ref();
+        throw;
+    }
     return decls;
 }
 
-string Loader::search_library(const string& libid, int* fd)
+// the keys of the loaded headers a header imports, see ModuleRegistry
+vector<uint64_t> Loader::import_keys(const vector<string>& imports)
+{
+    vector<uint64_t> keys;
+    for (auto& libid : imports) {
+        string path = ModuleRegistry::real_path(search_library(libid));
+        keys.push_back(ModuleRegistry::instance().key(path));
+    }
+    return keys;
+}
+
+// takes the reference of decls, path is the key of the header
+Declarations* Loader::publish(const string& path, Declarations* decls,
+                              uint32_t file, int64_t mtime, uint64_t hash,
+                              const vector<string>& imports)
+{
+    vector<string> deps;
+    for (auto& libid : imports) {
+        deps.push_back(ModuleRegistry::real_path(search_library(libid)));
+    }
+    decls->seal();
+    return ModuleRegistry::instance().put(path, decls, file, mtime, deps,
+                                          hash);
+}
+
+string Loader::search_library(const string& libid)
 {
     for (auto& path : load_path_) {
         auto s = path + "/" + lib_path(libid) + ".hb";
         // fprintf(stdout, "try path %s\n", s.c_str());
 
-        *fd = open(s.c_str(), O_RDONLY);
-        if (*fd == -1) {
+        struct stat st;
+        if (stat(s.c_str(), &st) == -1) {
             if (errno != ENOENT)
                 throw string(strerror(errno));
         } else {
@@ -1,6 +1,7 @@
 %{
 #include <stdio.h>
 #include "parser/lexer.hh"
+#include "front_end.h"
 %}
 
 // version of bison
@@ -25,8 +26,9 @@
 // to use yyscan_t than c++ class
 %param {yyscan_t lexer}
 
-// tracking location
+// tracking location, as byte offsets, see SourceRange
 %locations
+%define api.location.type {cbc::SourceRange}
 
 // 6 sr-conflicts, shifting is always the correct way to solve.
 %expect 6
@@ -45,14 +47,15 @@
     #include "loader.h"
     #include "entity.h"
     #include "option.h"
+    #include "source.h"
 
     using namespace cbc;
 
     // see lexer.l
     extern long integer_value(const string& image);
 
-    string string_value(const string& image);
-    char character_code(const string& image);
+    string string_value(const char* p, size_t n);
+    char character_code(const string& value);
     Location loc(yyscan_t lexer, const Token& token);
     IntegerLiteralNode* integer_node(const Location &loc, const string& image);
 
@@ -60,36 +63,38 @@
     Option* get_option(yyscan_t);
     string get_src_file(yyscan_t);
     Loader& get_loader(yyscan_t);
-    set<string>& get_typename(yyscan_t);
+    unordered_set<Symbol>& get_typename(yyscan_t);
     void add_known_types(Declarations*, yyscan_t);
+    void add_typename(Symbol, yyscan_t);
+    void check_header(Declarations*, yyscan_t);
+
+    // a function body, parsed or left for later, see Option::lazy_
+    struct FunctionBody {
+        BlockNode* block_;
+        LazyBody* lazy_;
+    };
+
+    LazyBody* lazy_body(yyscan_t, const cbc::SourceRange& range);
+    DefinedFunction* defined_function(bool priv, TypeNode* type, Symbol name,
+                                      Params* params, FunctionBody& body);
 }
 
-// inefficient but works
+// the scanner works on the buffer in place, so the offset of a token
+// is where yytext is, lines and columns are worked out when needed
 %code provides
 {
     #define YY_USER_ACTION \
-        loc->begin.line = loc->end.line = yylineno; \
-        loc->begin.column = yycolumn + 1; \
-        for (int i = 0; yytext[i] != 0; i++) { \
-            if (yytext[i] == '\n') { \
-                loc->end.line++; \
-                loc->end.column = 0; \
-                yycolumn = 0; \
-            } else { \
-                loc->end.column++; \
-                ++yycolumn; \
-            } \
-        }
+        loc->begin = yytext - ((Option*)yyextra)->text_; \
+        loc->end = loc->begin + yyleng;
 }
 
 %code provides
 {
     #define YY_SET_LOCATION \
-        tok.begin_line_ = loc->begin.line; \
-        tok.begin_column_ = loc->begin.column; \
-        tok.end_line_ = loc->end.line; \
-        tok.end_column_ = loc->end.column; \
-        yylval->emplace<Token>(tok); \
+        tok.offset_ = loc->begin; \
+        tok.image_ = yytext; \
+        tok.length_ = yyleng; \
+        yylval->emplace<Token>(move(tok)); \
         return tok.kind_;
 }
 
@@ -109,7 +114,8 @@
     #define XZERO(x) x->dec_ref(); x = nullptr;
 }
 
-%token <Token> COMPILE DECLARE ERROR
+%token <Token> COMPILE DECLARE BLOCK ERROR
+%token <Token> BODY
 %token <Token> '{' '}' '(' ')'
 %token <Token> PLUS_PLUS MINUS_MINUS AND_AND OR_OR LSHIFT RSHIFT
 %token <Token> EQ NE LE GE
@@ -152,6 +158,7 @@
 %type <vector<CaseNode*>> case_clauses
 %type <CaseNode*> case_clause
 %type <BlockNode*> case_body block
+%type <FunctionBody> body
 %type <ParamTypeRefs*> param_typerefs
 %type <ParamTypeRefs*> fixed_param_typerefs
 %type <TypeRef*> typeref_base typeref
@@ -160,10 +167,43 @@
 %type <vector<ExprNode*>> args
 %type <TypeNode*> type
 %type <ExprNode*> opt_expr term expr
-%type <ExprNode*> expr10 expr9 expr8 expr7 expr6 expr5 expr4 expr3 expr2 expr1
+%type <ExprNode*> binary
 %type <ExprNode*> postfix
 %type <ExprNode*> primary unary
-%type <string> name assign_op
+%type <Symbol> name
+%type <string> assign_op
+
+// values thrown away while recovering from an error; the actions
+// take over or release the others
+%destructor { $$->dec_ref(); } <Declarations*> <DefinedFunction*>
+%destructor { $$->dec_ref(); } <UndefinedFunction*> <UndefinedVariable*>
+%destructor { $$->dec_ref(); } <StructNode*> <UnionNode*> <Constant*>
+%destructor { $$->dec_ref(); } <TypedefNode*> <Params*> <Parameter*>
+%destructor { $$->dec_ref(); } <StmtNode*> <LabelNode*> <IfNode*>
+%destructor { $$->dec_ref(); } <DoWhileNode*> <WhileNode*> <ForNode*>
+%destructor { $$->dec_ref(); } <SwitchNode*> <GotoNode*> <ReturnNode*>
+%destructor { $$->dec_ref(); } <ContinueNode*> <BreakNode*> <CaseNode*>
+%destructor { $$->dec_ref(); } <BlockNode*> <ParamTypeRefs*> <TypeRef*>
+%destructor { $$->dec_ref(); } <TypeNode*> <ExprNode*>
+%destructor { for (auto* p : $$) p->dec_ref(); } <vector<DefinedVariable*>>
+%destructor { for (auto* p : $$) p->dec_ref(); } <vector<StmtNode*>>
+%destructor { for (auto* p : $$) p->dec_ref(); } <vector<CaseNode*>>
+%destructor { for (auto* p : $$) p->dec_ref(); } <vector<Slot*>>
+%destructor { for (auto* p : $$) p->dec_ref(); } <vector<ExprNode*>>
+%destructor { $$.block_->dec_ref(); $$.lazy_->dec_ref(); } <FunctionBody>
+
+// binary operators, from the loosest, a ? b : c ? d : e is
+// (a ? b : c) ? d : e
+%left '?'
+%left OR_OR
+%left AND_AND
+%left '>' '<' GE LE EQ NE
+%left '|'
+%left '^'
+%left '&'
+%left RSHIFT LSHIFT
+%left '+' '-'
+%left '*' '/' '%'
 
 %start compilation_or_declaraion
 
@@ -171,21 +211,19 @@
 
 compilation_or_declaraion : COMPILE top_defs {
               Token token;
-              token.begin_line_ = @2.begin.line;
-              token.begin_column_ = @2.begin.column;
+              token.offset_ = @2.begin;
               // use a pseudo token to get its location
-              auto* ast = new AST(loc(lexer, token), $2);
               auto* option = get_option(lexer);
+              auto* ast = new AST(loc(lexer, token), $2, option->constants_);
               option->ast_ = ast;
               XZERO($2);
           }
         | COMPILE import_stmts top_defs {
               Token token;
-              token.begin_line_ = @2.begin.line;
-              token.begin_column_ = @2.begin.column;
+              token.offset_ = @2.begin;
               $3->add($2);
-              auto* ast = new AST(loc(lexer, token), $3);
               auto* option = get_option(lexer);
+              auto* ast = new AST(loc(lexer, token), $3, option->constants_);
               option->ast_ = ast;
               // now $2 can be safely deleted;
               XZERO($2);
@@ -193,44 +231,39 @@ compilation_or_declaraion : COMPILE top_defs {
           }
         | DECLARE import_stmts {
               auto* option = get_option(lexer);
-              if ($2->defvars().size()) {
-                  throw string("can not define variable in .hb: ") + \
-                      option->src_;
-              } else if ($2->deffuncs().size()) {
-                  throw string("can not define function in .hb: ") + \
-                      option->src_;
-              }
+              check_header($2, lexer);
               option->decl_ = $2;
+              option->own_decl_ = new Declarations;
+              ZERO($2);
           }
         | DECLARE top_defs {
               auto* option = get_option(lexer);
-              if ($2->defvars().size()) {
-                  throw string("can not define variable in .hb: ") + \
-                      option->src_;
-              } else if ($2->deffuncs().size()) {
-                  throw string("can not define function in .hb: ") + \
-                      option->src_;
-              }
+              check_header($2, lexer);
               option->decl_ = $2;
+              option->own_decl_ = $2;
+              $2->inc_ref();
+              ZERO($2);
+          }
+        | BLOCK block {
+              // a lazy function body
+              get_option(lexer)->block_ = $2;
+              ZERO($2);
           }
         | DECLARE import_stmts top_defs {
               auto* option = get_option(lexer);
+              option->own_decl_ = new Declarations;
+              option->own_decl_->add($3);
               $3->add($2);
-              if ($3->defvars().size()) {
-                  /* TODO: print location */
-                  throw string("can not define variable in .hb: ") + \
-                      option->src_;
-              } else if ($3->deffuncs().size()) {
-                  throw string("can not define function in .hb: ") + \
-                      option->src_;
-              }
+              check_header($3, lexer);
               option->decl_ = $3;
+              ZERO($3);
               // now $2 can be safely deleted;
-              $2->dec_ref();
+              XZERO($2);
           }
         ;
 
 import_stmts : import_stmt {
+              get_option(lexer)->imports_.push_back($1);
               $$ = new Declarations;
               auto* decls = get_loader(lexer).load_library($1);
               if (decls) {
@@ -241,6 +274,7 @@ import_stmts : import_stmt {
               // don't delete it
           }
         | import_stmts import_stmt {
+              get_option(lexer)->imports_.push_back($2);
               auto* decls = get_loader(lexer).load_library($2);
               if (decls) {
                   $1->add(decls);
@@ -258,7 +292,7 @@ import_stmt : IMPORT import_component ';' {
           }
 
 import_component : name {
-              $$ = $1;
+              $$ = $1.str();
           }
 
 import_component : import_component '.' name {
@@ -281,91 +315,91 @@ top_defs : def_func { $$ = new Declarations; $$->add_deffunc($1); XZERO($1); }
         | top_defs def_struct { $1->add_defstruct($2); $$ = $1; ZERO($1); XZERO($2); }
         | top_defs def_union { $1->add_defunion($2); $$ = $1; ZERO($1); XZERO($2); }
         | top_defs def_typedef { $1->add_typedef($2); $$ = $1; ZERO($1); XZERO($2); }
+        // skip to the end of a bad definition and go on with the next
+        | error ';' { $$ = new Declarations; }
+        | error '}' { $$ = new Declarations; }
+        | top_defs error ';' { $$ = $1; ZERO($1); }
+        | top_defs error '}' { $$ = $1; ZERO($1); }
         ;
 
-def_func : typeref name '(' ')' block {
+def_func : typeref name '(' ')' body {
               auto v = vector<Parameter*>{};
               auto params = new Params(loc(lexer, $3), move(v));
               auto tref = params->parameter_typerefs();
               auto ref = new FunctionTypeRef($1, tref); // ret type, param type
               auto type = new TypeNode(ref); // type
 
-              $$ = new DefinedFunction(false, type, $2, params, $5);
+              $$ = defined_function(false, type, $2, params, $5);
 
               type->dec_ref();
               ref->dec_ref();
               tref->dec_ref();
               params->dec_ref();
               XZERO($1);
-              XZERO($5);
           }
-        | typeref name '(' VOID ')' block {
+        | typeref name '(' VOID ')' body {
               auto v = vector<Parameter*>{};
               auto params = new Params(loc(lexer, $4), move(v));
               auto tref = params->parameter_typerefs();
               auto ref = new FunctionTypeRef($1, tref); // ret type, param type
               auto type = new TypeNode(ref);
 
-              $$ = new DefinedFunction(false, type, $2, params, $6);
+              $$ = defined_function(false, type, $2, params, $6);
 
               type->dec_ref();
               ref->dec_ref();
               tref->dec_ref();
               params->dec_ref();
               XZERO($1);
-              XZERO($6);
           }
-        | STATIC typeref name '(' ')' block {
+        | STATIC typeref name '(' ')' body {
               auto v = vector<Parameter*>{};
               auto params = new Params(loc(lexer, $4), move(v));
               auto tref = params->parameter_typerefs();
               auto ref = new FunctionTypeRef($2, tref);
               auto type = new TypeNode(ref);
 
-              $$ = new DefinedFunction(true, type, $3, params, $6);
+              $$ = defined_function(true, type, $3, params, $6);
 
               type->dec_ref();
               ref->dec_ref();
               tref->dec_ref();
               params->dec_ref();
               XZERO($2);
-              XZERO($6);
           }
-        | STATIC typeref name '(' VOID ')' block {
+        | STATIC typeref name '(' VOID ')' body {
               auto v = vector<Parameter*>{};
               auto params = new Params(loc(lexer, $5), move(v));
               auto tref = params->parameter_typerefs();
               auto ref = new FunctionTypeRef($2, tref);
               auto type = new TypeNode(ref);
 
-              $$ = new DefinedFunction(true, type, $3, params, $7);
+              $$ = defined_function(true, type, $3, params, $7);
 
               type->dec_ref();
               ref->dec_ref();
               tref->dec_ref();
               params->dec_ref();
               XZERO($2);
-              XZERO($7);
           }
-        | typeref name '(' params ')' block {
+        | typeref name '(' params ')' body {
               auto tref = $4->parameter_typerefs();
               auto ref = new FunctionTypeRef($1, tref);
               auto type = new TypeNode(ref);
 
-              $$ = new DefinedFunction(false, type, $2, $4, $6);
+              $$ = defined_function(false, type, $2, $4, $6);
 
               type->dec_ref();
               ref->dec_ref();
               tref->dec_ref();
               XZERO($1);
               XZERO($4);
-              XZERO($6);
           }
-        | STATIC typeref name '(' params ')' block {
+        | STATIC typeref name '(' params ')' body {
               auto tref = $5->parameter_typerefs();
               auto ref = new FunctionTypeRef($2, tref);
               auto type = new TypeNode(ref);
-              $$ = new DefinedFunction(false,
+              $$ = defined_function(false,
                     type, $3, $5, $7);
 
               type->dec_ref();
@@ -373,7 +407,6 @@ def_func : typeref name '(' ')' block {
               tref->dec_ref();
               XZERO($2);
               XZERO($5);
-              XZERO($7);
           }
         ;
 
@@ -517,28 +550,31 @@ def_union : UNION name member_list ';' {
         ;
 
 def_typedef : TYPEDEF typeref IDENTIFIER ';' {
-              $$ = new TypedefNode(loc(lexer, $1), $2, $3.image_);
-              auto& s = get_typename(lexer);
-              s.insert($3.image_);
+              $$ = new TypedefNode(loc(lexer, $1), $2, $3.symbol_);
+              add_typename($3.symbol_, lexer);
               XZERO($2);
           }
         ;
 
-params : fixed_params { $$ = move($1); }
+params : fixed_params { $$ = $1; ZERO($1); }
         | fixed_params ',' ELLIPSIS {
               $1->accept_varargs();
-              $$ = move($1);
+              $$ = $1;
+              ZERO($1);
           }
         ;
 
 fixed_params : param {
               auto v = vector<Parameter*>{$1};
               $$ = new Params($1->location(), move(v));
+              ZERO($1);
           }
         | fixed_params ',' param  {
               assert($3->get_ref() == 1);
               $1->param_descs_.push_back($3);
-              $$ = move($1);
+              $$ = $1;
+              ZERO($1);
+              ZERO($3);
           }
         ;
 
@@ -550,6 +586,15 @@ param : typeref name {
           }
         ;
 
+body : block {
+              $$ = FunctionBody{$1, nullptr};
+              ZERO($1);
+          }
+        | BODY {
+              $$ = FunctionBody{nullptr, lazy_body(lexer, @1)};
+          }
+        ;
+
 block : '{' '}' {
               auto v = vector<DefinedVariable*>{};
               auto v2 = vector<StmtNode*>{};
@@ -566,6 +611,11 @@ block : '{' '}' {
         | '{' def_var_list stmts '}' {
               $$ = new BlockNode(loc(lexer, $1), move($2), move($3));
           }
+        | '{' error '}' {
+              auto v = vector<DefinedVariable*>{};
+              auto v2 = vector<StmtNode*>{};
+              $$ = new BlockNode(loc(lexer, $1), move(v), move(v2));
+          }
         ;
 
 type : typeref {
@@ -580,7 +630,7 @@ typeref : typeref_base  { $$ = $1; ZERO($1); }
               XZERO($1);
           }
         | typeref_base '[' INTEGER ']' {
-              $$ = new ArrayTypeRef($1, integer_value($3.image_));
+              $$ = new ArrayTypeRef($1, integer_value($3.image()));
               XZERO($1);
           }
         | typeref_base '*' {
@@ -604,7 +654,7 @@ typeref : typeref_base  { $$ = $1; ZERO($1); }
               XZERO($1);
           }
         | typeref '[' INTEGER ']' {
-              $$ = new ArrayTypeRef($1, integer_value($3.image_));
+              $$ = new ArrayTypeRef($1, integer_value($3.image()));
               XZERO($1);
           }
         | typeref '*' {
@@ -625,10 +675,11 @@ typeref : typeref_base  { $$ = $1; ZERO($1); }
           }
         ;
 
-param_typerefs : fixed_param_typerefs { $$ = move($1); }
+param_typerefs : fixed_param_typerefs { $$ = $1; ZERO($1); }
         | fixed_param_typerefs ',' ELLIPSIS {
-              $$ = move($1);
+              $$ = $1;
               $$->accept_varargs();
+              ZERO($1);
           }
         ;
 
@@ -641,11 +692,14 @@ fixed_param_typerefs : typeref {
         | fixed_param_typerefs ',' typeref {
               assert($3->get_ref() == 1);
               $1->param_descs_.push_back($3);
-              $$ = move($1);
+              $$ = $1;
+              ZERO($1);
+              ZERO($3);
           }
         ;
 
 stmt : ';' { $$ = nullptr; }
+        | error ';' { $$ = nullptr; }
         | label_stmt     { $$ = $1; ZERO($1); }
         | expr ';'       { $$ = new ExprStmtNode($1->location(), $1); XZERO($1); }
         | block          { $$ = $1; ZERO($1); }
@@ -661,7 +715,7 @@ stmt : ';' { $$ = nullptr; }
         ;
 
 label_stmt : IDENTIFIER ':' stmt {
-              $$ = new LabelNode(loc(lexer, $1), $1.image_, $3);
+              $$ = new LabelNode(loc(lexer, $1), $1.symbol_, $3);
               XZERO($3);
           }
         ;
@@ -703,7 +757,7 @@ for_stmt : FOR '(' opt_expr ';' opt_expr ';' opt_expr ')' stmt {
         ;
 
 goto_stmt : GOTO IDENTIFIER ';' {
-              $$ = new GotoNode(loc(lexer, $1), $2.image_);
+              $$ = new GotoNode(loc(lexer, $1), $2.symbol_);
           }
         ;
 
@@ -755,8 +809,10 @@ cases : CASE primary ':' {
 case_body : stmts {
               /* don't need to check break, C-Language switch
               * statement and have no breaks. */
+              Token token;
+              token.offset_ = @1.begin;
               auto v = vector<DefinedVariable*>{};
-              $$ = new BlockNode($1[0]->location(), move(v), move($1));
+              $$ = new BlockNode(loc(lexer, token), move(v), move($1));
           }
         ;
 
@@ -820,9 +876,9 @@ typeref_base : VOID { $$ = new VoidTypeRef(loc(lexer, $1)); }
         | UNSIGNED SHORT { $$ = IntegerTypeRef::ushort_ref(loc(lexer, $1)); }
         | UNSIGNED INT { $$ = IntegerTypeRef::uint_ref(loc(lexer, $1)); }
         | UNSIGNED LONG {  $$ = IntegerTypeRef::ulong_ref(loc(lexer, $1)); }
-        | STRUCT IDENTIFIER {  $$ = new StructTypeRef(loc(lexer, $1), $2.image_); }
-        | UNION IDENTIFIER { $$ = new UnionTypeRef(loc(lexer, $1), $2.image_); }
-        | TYPENAME { $$ = new UserTypeRef(loc(lexer, $1), $1.image_); }
+        | STRUCT IDENTIFIER {  $$ = new StructTypeRef(loc(lexer, $1), $2.symbol_); }
+        | UNION IDENTIFIER { $$ = new UnionTypeRef(loc(lexer, $1), $2.symbol_); }
+        | TYPENAME { $$ = new UserTypeRef(loc(lexer, $1), $1.symbol_); }
         ;
 
 assign_op : PLUS_ASSIGN { $$ = "+"; }
@@ -839,81 +895,46 @@ assign_op : PLUS_ASSIGN { $$ = "+"; }
 
 expr : term '=' expr { $$ = new AssignNode($1, $3); XZERO($1); XZERO($3); }
     | term assign_op expr { $$ = new OpAssignNode($1, $2, $3); XZERO($1); XZERO($3); }
-    | expr10 { assert($1->get_ref() == 1); $$ = $1; ZERO($1); }
+    | binary { assert($1->get_ref() == 1); $$ = $1; ZERO($1); }
     ;
 
-expr10 : expr10 '?' expr ':' expr9 {
+/* All the binary operators are in one nonterminal, their precedence
+ * and associativity are declared above, so an operand takes a single
+ * reduction instead of one for each level.
+ */
+binary : term { $$ = $1; ZERO($1); }
+        | binary '?' expr ':' binary %prec '?' {
               $$ = new CondExprNode($1, $3, $5);
               XZERO($1);
               XZERO($3);
               XZERO($5);
           }
-        | expr9 { $$ = $1; ZERO($1); }
-        ;
-
-expr9 : expr8 { $$ = $1; ZERO($1); }
-        | expr9 OR_OR expr8 {
+        | binary OR_OR binary {
               $$ = new LogicalOrNode($1, $3);
               XZERO($1);
               XZERO($3);
           }
-        ;
-
-expr8 : expr7 { $$ = $1; ZERO($1); }
-        | expr8 AND_AND expr7 {
+        | binary AND_AND binary {
               $$ = new LogicalAndNode($1, $3);
               XZERO($1);
               XZERO($3);
           }
-        ;
-
-expr7 : expr6 { $$ = $1; ZERO($1); }
-        | expr7 '>' expr6 { $$ = new BinaryOpNode($1, ">", $3); XZERO($1); XZERO($3); }
-        | expr7 '<' expr6 { $$ = new BinaryOpNode($1, "<", $3); XZERO($1); XZERO($3); }
-        | expr7 GE expr6 { $$ = new BinaryOpNode($1, ">=", $3); XZERO($1); XZERO($3); }
-        | expr7 LE expr6 { $$ = new BinaryOpNode($1, "<=", $3); XZERO($1); XZERO($3); }
-        | expr7 EQ expr6 { $$ = new BinaryOpNode($1, "==", $3); XZERO($1); XZERO($3); }
-        | expr7 NE expr6 { $$ = new BinaryOpNode($1, "!=", $3); XZERO($1); XZERO($3); }
-        ;
-
-expr6 : expr5 { $$ = $1; ZERO($1); }
-        | expr6 '|' expr5 {
-              $$ = new BinaryOpNode($1, "|", $3);
-              XZERO($1);
-              XZERO($3);
-          }
-        ;
-
-expr5 : expr4 { $$ = $1; ZERO($1); }
-        | expr5 '^' expr4 {
-              $$ = new BinaryOpNode($1, "^", $3);
-              XZERO($1);
-              XZERO($3);
-          }
-        ;
-
-expr4 : expr3 { $$ = $1; ZERO($1); }
-        | expr4 '&' expr3 {
-              $$ = new BinaryOpNode($1, "&", $3);
-              XZERO($1);
-              XZERO($3);
-          }
-        ;
-
-expr3 : expr2 { $$ = $1; ZERO($1); }
-        | expr3 RSHIFT expr2 { $$ = new BinaryOpNode($1, ">>", $3); XZERO($1); XZERO($3); }
-        | expr3 LSHIFT expr2 { $$ = new BinaryOpNode($1, "<<", $3); XZERO($1); XZERO($3); }
-        ;
-
-expr2 : expr1 { $$ = $1; ZERO($1); }
-        | expr2 '+' expr1 { $$ = new BinaryOpNode($1, "+", $3); XZERO($1); XZERO($3); }
-        | expr2 '-' expr1 { $$ = new BinaryOpNode($1, "-", $3); XZERO($1); XZERO($3); }
-        ;
-
-expr1 : term { $$ = $1; ZERO($1); }
-        | expr1 '*' term { $$ = new BinaryOpNode($1, "*", $3); XZERO($1); XZERO($3); }
-        | expr1 '/' term { $$ = new BinaryOpNode($1, "/", $3); XZERO($1); XZERO($3); }
-        | expr1 '%' term { $$ = new BinaryOpNode($1, "%", $3); XZERO($1); XZERO($3); }
+        | binary '>' binary { $$ = new BinaryOpNode($1, ">", $3); XZERO($1); XZERO($3); }
+        | binary '<' binary { $$ = new BinaryOpNode($1, "<", $3); XZERO($1); XZERO($3); }
+        | binary GE binary { $$ = new BinaryOpNode($1, ">=", $3); XZERO($1); XZERO($3); }
+        | binary LE binary { $$ = new BinaryOpNode($1, "<=", $3); XZERO($1); XZERO($3); }
+        | binary EQ binary { $$ = new BinaryOpNode($1, "==", $3); XZERO($1); XZERO($3); }
+        | binary NE binary { $$ = new BinaryOpNode($1, "!=", $3); XZERO($1); XZERO($3); }
+        | binary '|' binary { $$ = new BinaryOpNode($1, "|", $3); XZERO($1); XZERO($3); }
+        | binary '^' binary { $$ = new BinaryOpNode($1, "^", $3); XZERO($1); XZERO($3); }
+        | binary '&' binary { $$ = new BinaryOpNode($1, "&", $3); XZERO($1); XZERO($3); }
+        | binary RSHIFT binary { $$ = new BinaryOpNode($1, ">>", $3); XZERO($1); XZERO($3); }
+        | binary LSHIFT binary { $$ = new BinaryOpNode($1, "<<", $3); XZERO($1); XZERO($3); }
+        | binary '+' binary { $$ = new BinaryOpNode($1, "+", $3); XZERO($1); XZERO($3); }
+        | binary '-' binary { $$ = new BinaryOpNode($1, "-", $3); XZERO($1); XZERO($3); }
+        | binary '*' binary { $$ = new BinaryOpNode($1, "*", $3); XZERO($1); XZERO($3); }
+        | binary '/' binary { $$ = new BinaryOpNode($1, "/", $3); XZERO($1); XZERO($3); }
+        | binary '%' binary { $$ = new BinaryOpNode($1, "%", $3); XZERO($1); XZERO($3); }
         ;
 
 term : '(' type ')' term { $$ = new CastNode($2, $4); XZERO($2); XZERO($4);}
@@ -980,7 +1001,7 @@ postfix : primary {
           }
         ;
 
-name : IDENTIFIER { $$ = $1.image_; }
+name : IDENTIFIER { $$ = $1.symbol_; }
 
 
 args : expr { $$ = vector<ExprNode*> {$1};
@@ -993,21 +1014,23 @@ args : expr { $$ = vector<ExprNode*> {$1};
           }
         ;
 
-primary : INTEGER       { $$ = integer_node(loc(lexer, $1), $1.image_); }
-        | CHARACTER     { char c = character_code($1.image_);
+primary : INTEGER       { $$ = integer_node(loc(lexer, $1), $1.image()); }
+        | CHARACTER     { char c = character_code($1.value_);
                           auto* ref = IntegerTypeRef::char_ref();
                           $$ = new IntegerLiteralNode(loc(lexer, $1), ref, c);
                           ref->dec_ref();
                         }
         | STRING        { auto* ref = IntegerTypeRef::char_ref();
                           auto* pref = new PointerTypeRef(ref);
+                          auto* entry = get_option(lexer)->constants_->intern(
+                              $1.value_);
                           $$ = new StringLiteralNode(
-                              loc(lexer, $1), pref, $1.image_);
+                              loc(lexer, $1), pref, entry);
 
                           pref->dec_ref();
                           ref->dec_ref();
                         }
-        | IDENTIFIER    { $$ = new VariableNode(loc(lexer, $1), $1.image_); }
+        | IDENTIFIER    { $$ = new VariableNode(loc(lexer, $1), $1.symbol_); }
         | '(' expr ')'  { $$ = $2; ZERO($2); }
         ;
 
@@ -1016,7 +1039,7 @@ primary : INTEGER       { $$ = integer_node(loc(lexer, $1), $1.image_); }
 Location loc(yyscan_t lexer, const Token& token)
 {
     Option* opt = get_option(lexer);
-    return Location(opt->src_, token);
+    return Location(opt->file_, token.offset_);
 }
 
 IntegerLiteralNode* integer_node(const Location &loc, const string& image)
@@ -1043,9 +1066,8 @@ IntegerLiteralNode* integer_node(const Location &loc, const string& image)
 
 void parser::Parser::error(const location_type& loc, const std::string& msg)
 {
-    printf("%s at %s:%d,%d\n", msg.c_str(),
-        get_src_file(lexer).c_str(),
-        loc.begin.line, loc.begin.column);
+    auto* option = get_option(lexer);
+    option->errors_->error(Location(option->file_, loc.begin), msg);
 }
 
 /* A simple hack to support multi starting point. */
@@ -1056,9 +1078,18 @@ int yylex(parser::Parser::semantic_type *yylval,
     if (option->start_) {
         auto ret = option->start_;
         option->start_ = 0;
+        yylval->emplace<Token>(Token(ret));
         return ret;
     }
-    return _yylex(yylval, loc, lexer);
+    int ret = _yylex(yylval, loc, lexer);
+    if (ret == '{') {
+        option->depth_++;
+    } else if (ret == '}') {
+        option->depth_--;
+    }
+    // only a function body follows a ')' outside braces
+    option->body_next_ = option->lazy_ && option->depth_ == 0 && ret == ')';
+    return ret;
 }
 
 Option* get_option(yyscan_t lexer)
@@ -1073,18 +1104,151 @@ string get_src_file(yyscan_t lexer)
 
 Loader& get_loader(yyscan_t lexer)
 {
-    return ((Option*)yyget_extra(lexer))->loader_;
+    return *((Option*)yyget_extra(lexer))->loader_;
 }
 
-set<string>& get_typename(yyscan_t lexer)
+unordered_set<Symbol>& get_typename(yyscan_t lexer)
 {
     return ((Option*)yyget_extra(lexer))->typename_;
 }
 
+// a header only declares things
+void check_header(Declarations* decls, yyscan_t lexer)
+{
+    auto* errors = get_option(lexer)->errors_;
+    for (auto* var : decls->defvars()) {
+        errors->error(var->location(),
+                      "can not define variable in .hb: " + var->symbol_string());
+    }
+    for (auto* func : decls->deffuncs()) {
+        errors->error(func->location(),
+                      "can not define function in .hb: " + func->symbol_string());
+    }
+}
+
 void add_known_types(Declarations* decl, yyscan_t lexer)
 {
-    auto& s = get_typename(lexer);
     for (auto* type : decl->typedefs()) {
-        s.insert(type->name());
+        add_typename(type->name(), lexer);
+    }
+}
+
+/* What the skipped bodies of a file need to be parsed later: where
+ * they are, and the type names in the order they were declared, since
+ * a body may only see the ones before it. Each parsed body gets a
+ * segment of the file (see SourceManager::add_segment()) for the
+ * locations of its nodes, which stays until the AST is gone. The
+ * segments are cut from the file, so it is removed with the
+ * LazyBodies rather than by whoever loaded it.
+ */
+class LazyBodies : public Object {
+public:
+    LazyBodies(Option* option) :
+        file_(option->file_), src_(option->src_), os_(option->os_),
+        errors_(option->errors_), constants_(option->constants_),
+        names_(option->typename_.begin(), option->typename_.end()) {}
+
+    ~LazyBodies() {
+        for (auto id : segments_) {
+            SourceManager::instance().remove(id);
+        }
+        SourceManager::instance().remove(file_);
+    }
+
+    BlockNode* parse(uint32_t begin, uint32_t size, size_t ntypes);
+
+public:
+    uint32_t file_;
+    string src_;
+    ostream* os_;
+    ErrorHandler* errors_;
+    ConstantTable* constants_;
+    vector<Symbol> names_;
+
+protected:
+    vector<uint32_t> segments_;
+};
+
+class SkippedBody : public LazyBody {
+public:
+    SkippedBody(LazyBodies* bodies, uint32_t begin, uint32_t size) :
+        bodies_(bodies), begin_(begin), size_(size),
+        ntypes_(bodies->names_.size())
+    {
+        bodies_->inc_ref();
+    }
+
+    ~SkippedBody() { bodies_->dec_ref(); }
+
+    BlockNode* parse() { return bodies_->parse(begin_, size_, ntypes_); }
+
+protected:
+    LazyBodies* bodies_;
+    uint32_t begin_;
+    uint32_t size_;
+    size_t ntypes_;
+};
+
+BlockNode* LazyBodies::parse(uint32_t begin, uint32_t size, size_t ntypes)
+{
+    SourceManager& sm = SourceManager::instance();
+    uint32_t id = sm.add_segment(file_, begin, size);
+    if (!id) {
+        throw string("source of a function body is gone: ") + src_;
+    }
+    segments_.push_back(id);
+    SourceFile* source = sm.file(id);
+
+    FrontEnd::Lease front_end;
+    Option& option = front_end->option();
+    option.src_ = src_;
+    option.file_ = id;
+    option.text_ = source->buffer();
+    option.os_ = os_;
+    option.errors_ = errors_;
+    option.constants_ = constants_;
+    option.start_ = parser::Parser::token::BLOCK;
+    option.typename_.insert(names_.begin(), names_.begin() + ntypes);
+    long errors = errors_->errors();
+
+    front_end->scan(source);
+    int res = front_end->parse();
+    if (res != 0 || errors_->errors() > errors) {
+        throw string("syntax error in a function body of ") + src_;
+    }
+    return option.block_;
+}
+
+void add_typename(Symbol name, yyscan_t lexer)
+{
+    auto* option = get_option(lexer);
+    if (option->typename_.insert(name).second && option->bodies_) {
+        static_cast<LazyBodies*>(option->bodies_)->names_.push_back(name);
+    }
+}
+
+LazyBody* lazy_body(yyscan_t lexer, const cbc::SourceRange& range)
+{
+    auto* option = get_option(lexer);
+    if (!option->bodies_) {
+        option->bodies_ = new LazyBodies(option);
+    }
+    auto* bodies = static_cast<LazyBodies*>(option->bodies_);
+    return new SkippedBody(bodies, range.begin, range.end - range.begin);
+}
+
+DefinedFunction* defined_function(bool priv, TypeNode* type, Symbol name,
+                                  Params* params, FunctionBody& body)
+{
+    DefinedFunction* func;
+    if (body.lazy_) {
+        func = new DefinedFunction(priv, type, name, params, body.lazy_);
+        body.lazy_->dec_ref();
+    } else {
+        func = new DefinedFunction(priv, type, name, params, body.block_);
+        body.block_->dec_ref();
     }
+    body.block_ = nullptr;
+    body.lazy_ = nullptr;
+    return func;
 }
@@ -0,0 +1,441 @@
+%{
+#include <stdio.h>
+#include "parser/lexer.hh"
+%}
+
+/* The grammar of parser.y without its actions, for --syntax-only. It
+ * builds nothing but what the scanner needs: the type names declared
+ * by typedefs and by the imported headers. The rules and the tokens
+ * must be kept the same as in parser.y, the token numbers are checked
+ * at the end of this file.
+ */
+
+%require "3.8"
+%language "c++"
+%define api.namespace {parser}
+%define api.parser.class {Recognizer}
+%define api.value.type variant
+%define parse.error detailed
+%param {yyscan_t lexer}
+%locations
+%define api.location.type {cbc::SourceRange}
+
+// the same as parser.y
+%expect 6
+
+%code requires
+{
+    #include <string>
+
+    #include "parser/parser.hh"
+}
+
+%code provides
+{
+    int yylex(parser::Recognizer::semantic_type *yylval,
+            parser::Recognizer::location_type *loc, yyscan_t yyscanner);
+}
+
+%token COMPILE DECLARE BLOCK ERROR
+%token BODY
+%token '{' '}' '(' ')'
+%token PLUS_PLUS MINUS_MINUS AND_AND OR_OR LSHIFT RSHIFT
+%token EQ NE LE GE
+%token PLUS_ASSIGN MINUS_ASSIGN MULTIPLY_ASSIGN DIVIDE_ASSIGN MOD_ASSIGN
+%token AND_ASSIGN OR_ASSIGN XOR_ASSIGN LSHIFT_ASSIGN RSHIFT_ASSIGN
+%token POINT_TO ELLIPSIS
+%token VOID CHAR SHORT INT LONG
+%token TYPEDEF STRUCT UNION ENUM
+%token STATIC EXTERN
+%token SIGNED UNSIGNED CONST
+%token IF ELSE SWITCH CASE DEFAULT WHILE DO FOR RETURN BREAK CONTINUE GOTO
+%token IMPORT SIZEOF
+%token <Symbol> IDENTIFIER
+%token TYPENAME INTEGER CHARACTER STRING
+
+%type <Symbol> name
+%type <string> import_stmt import_component
+
+%left '?'
+%left OR_OR
+%left AND_AND
+%left '>' '<' GE LE EQ NE
+%left '|'
+%left '^'
+%left '&'
+%left RSHIFT LSHIFT
+%left '+' '-'
+%left '*' '/' '%'
+
+%start compilation_or_declaraion
+
+%%
+
+compilation_or_declaraion : COMPILE top_defs
+        | COMPILE import_stmts top_defs
+        | DECLARE import_stmts
+        | DECLARE top_defs
+        | BLOCK block
+        | DECLARE import_stmts top_defs
+        ;
+
+import_stmts : import_stmt
+        | import_stmts import_stmt
+        ;
+
+import_stmt : IMPORT import_component ';' {
+              get_option(lexer)->imports_.push_back($2);
+              auto* decls = get_loader(lexer).load_library($2);
+              if (decls) {
+                  add_known_types(decls, lexer);
+              }
+          }
+        ;
+
+import_component : name { $$ = $1.str(); }
+        | import_component '.' name { $$ = $1 + "." + $3; }
+        ;
+
+top_defs : def_func
+        | def_vars ';'
+        | decl_func
+        | decl_var
+        | def_const
+        | def_struct
+        | def_union
+        | def_typedef
+        | top_defs def_func
+        | top_defs def_vars ';'
+        | top_defs decl_func
+        | top_defs decl_var
+        | top_defs def_const
+        | top_defs def_struct
+        | top_defs def_union
+        | top_defs def_typedef
+        | error ';'
+        | error '}'
+        | top_defs error ';'
+        | top_defs error '}'
+        ;
+
+def_func : typeref name '(' ')' body
+        | typeref name '(' VOID ')' body
+        | STATIC typeref name '(' ')' body
+        | STATIC typeref name '(' VOID ')' body
+        | typeref name '(' params ')' body
+        | STATIC typeref name '(' params ')' body
+        ;
+
+decl_func : EXTERN typeref name '(' ')' ';'
+        | EXTERN typeref name '(' VOID ')' ';'
+        | EXTERN typeref name '(' params ')' ';'
+        ;
+
+decl_var : EXTERN typeref name ';'
+        ;
+
+def_var_list : def_vars ';'
+        | def_var_list def_vars ';'
+        ;
+
+def_vars : typeref name
+        | typeref name '=' expr
+        | STATIC typeref name
+        | STATIC typeref name '=' expr
+        | def_vars ',' name
+        | def_vars ',' name '=' expr
+        ;
+
+def_const : CONST typeref name '=' expr ';'
+        ;
+
+def_struct : STRUCT name member_list ';'
+        ;
+
+def_union : UNION name member_list ';'
+        ;
+
+def_typedef : TYPEDEF typeref IDENTIFIER ';' { add_typename($3, lexer); }
+        ;
+
+params : fixed_params
+        | fixed_params ',' ELLIPSIS
+        ;
+
+fixed_params : param
+        | fixed_params ',' param
+        ;
+
+param : typeref name
+        ;
+
+body : block
+        | BODY
+        ;
+
+block : '{' '}'
+        | '{' stmts '}'
+        | '{' def_var_list '}'
+        | '{' def_var_list stmts '}'
+        | '{' error '}'
+        ;
+
+type : typeref
+        ;
+
+typeref : typeref_base
+        | typeref_base '[' ']'
+        | typeref_base '[' INTEGER ']'
+        | typeref_base '*'
+        | typeref_base '(' VOID ')'
+        | typeref_base '(' param_typerefs ')'
+        | typeref '[' ']'
+        | typeref '[' INTEGER ']'
+        | typeref '*'
+        | typeref '(' VOID ')'
+        | typeref '(' param_typerefs ')'
+        ;
+
+param_typerefs : fixed_param_typerefs
+        | fixed_param_typerefs ',' ELLIPSIS
+        ;
+
+fixed_param_typerefs : typeref
+        | fixed_param_typerefs ',' typeref
+        ;
+
+stmt : ';'
+        | error ';'
+        | label_stmt
+        | expr ';'
+        | block
+        | if_stmt
+        | while_stmt
+        | dowhile_stmt
+        | for_stmt
+        | switch_stmt
+        | break_stmt
+        | continue_stmt
+        | goto_stmt
+        | return_stmt
+        ;
+
+label_stmt : IDENTIFIER ':' stmt
+        ;
+
+if_stmt : IF '(' expr ')' stmt ELSE stmt
+        | IF '(' expr ')' stmt
+        ;
+
+while_stmt : WHILE '(' expr ')' stmt
+        ;
+
+dowhile_stmt : DO stmt WHILE '(' expr ')' ';'
+        ;
+
+for_stmt : FOR '(' opt_expr ';' opt_expr ';' opt_expr ')' stmt
+        ;
+
+goto_stmt : GOTO IDENTIFIER ';'
+        ;
+
+switch_stmt : SWITCH '(' expr ')' '{' case_clauses '}'
+        ;
+
+case_clauses : case_clause
+        | case_clauses case_clause
+        ;
+
+case_clause : cases case_body
+        ;
+
+cases : CASE primary ':'
+        | DEFAULT ':'
+        | cases CASE primary ':'
+        | cases DEFAULT ':'
+        ;
+
+case_body : stmts
+        ;
+
+return_stmt : RETURN ';'
+        | RETURN expr ';'
+        ;
+
+continue_stmt : CONTINUE ';'
+        ;
+
+break_stmt : BREAK ';'
+        ;
+
+stmts : stmt
+        | stmts stmt
+        ;
+
+member_list : '{' '}'
+        | '{' slots '}'
+        ;
+
+slots : type name ';'
+        | slots type name ';'
+        ;
+
+opt_expr : %empty
+        | expr
+        ;
+
+typeref_base : VOID
+        | CHAR
+        | SHORT
+        | INT
+        | LONG
+        | UNSIGNED CHAR
+        | UNSIGNED SHORT
+        | UNSIGNED INT
+        | UNSIGNED LONG
+        | STRUCT IDENTIFIER
+        | UNION IDENTIFIER
+        | TYPENAME
+        ;
+
+assign_op : PLUS_ASSIGN
+        | MINUS_ASSIGN
+        | MULTIPLY_ASSIGN
+        | DIVIDE_ASSIGN
+        | MOD_ASSIGN
+        | AND_ASSIGN
+        | OR_ASSIGN
+        | XOR_ASSIGN
+        | LSHIFT_ASSIGN
+        | RSHIFT_ASSIGN
+        ;
+
+expr : term '=' expr
+        | term assign_op expr
+        | binary
+        ;
+
+binary : term
+        | binary '?' expr ':' binary %prec '?'
+        | binary OR_OR binary
+        | binary AND_AND binary
+        | binary '>' binary
+        | binary '<' binary
+        | binary GE binary
+        | binary LE binary
+        | binary EQ binary
+        | binary NE binary
+        | binary '|' binary
+        | binary '^' binary
+        | binary '&' binary
+        | binary RSHIFT binary
+        | binary LSHIFT binary
+        | binary '+' binary
+        | binary '-' binary
+        | binary '*' binary
+        | binary '/' binary
+        | binary '%' binary
+        ;
+
+term : '(' type ')' term
+        | unary
+        ;
+
+unary : PLUS_PLUS unary
+        | MINUS_MINUS unary
+        | '+' term
+        | '-' term
+        | '!' term
+        | '~' term
+        | '*' term
+        | '&' term
+        | SIZEOF '(' type ')'
+        | SIZEOF unary
+        | postfix
+        ;
+
+postfix : primary
+        | postfix PLUS_PLUS
+        | postfix MINUS_MINUS
+        | postfix '[' expr ']'
+        | postfix '.' name
+        | postfix POINT_TO name
+        | postfix '(' ')'
+        | postfix '(' args ')'
+        ;
+
+name : IDENTIFIER { $$ = $1; }
+        ;
+
+args : expr
+        | args ',' expr
+        ;
+
+primary : INTEGER
+        | CHARACTER
+        | STRING
+        | IDENTIFIER
+        | '(' expr ')'
+        ;
+
+%%
+
+#define SAME_TOKEN(t) \
+    static_assert(static_cast<int>(parser::Recognizer::token::t) == \
+                  static_cast<int>(parser::Parser::token::t), \
+                  "token " #t " differs from parser.y");
+
+SAME_TOKEN(COMPILE) SAME_TOKEN(DECLARE) SAME_TOKEN(BLOCK) SAME_TOKEN(ERROR)
+SAME_TOKEN(BODY)
+SAME_TOKEN(PLUS_PLUS) SAME_TOKEN(MINUS_MINUS) SAME_TOKEN(AND_AND)
+SAME_TOKEN(OR_OR) SAME_TOKEN(LSHIFT) SAME_TOKEN(RSHIFT)
+SAME_TOKEN(EQ) SAME_TOKEN(NE) SAME_TOKEN(LE) SAME_TOKEN(GE)
+SAME_TOKEN(PLUS_ASSIGN) SAME_TOKEN(MINUS_ASSIGN) SAME_TOKEN(MULTIPLY_ASSIGN)
+SAME_TOKEN(DIVIDE_ASSIGN) SAME_TOKEN(MOD_ASSIGN)
+SAME_TOKEN(AND_ASSIGN) SAME_TOKEN(OR_ASSIGN) SAME_TOKEN(XOR_ASSIGN)
+SAME_TOKEN(LSHIFT_ASSIGN) SAME_TOKEN(RSHIFT_ASSIGN)
+SAME_TOKEN(POINT_TO) SAME_TOKEN(ELLIPSIS)
+SAME_TOKEN(VOID) SAME_TOKEN(CHAR) SAME_TOKEN(SHORT) SAME_TOKEN(INT)
+SAME_TOKEN(LONG)
+SAME_TOKEN(TYPEDEF) SAME_TOKEN(STRUCT) SAME_TOKEN(UNION) SAME_TOKEN(ENUM)
+SAME_TOKEN(STATIC) SAME_TOKEN(EXTERN)
+SAME_TOKEN(SIGNED) SAME_TOKEN(UNSIGNED) SAME_TOKEN(CONST)
+SAME_TOKEN(IF) SAME_TOKEN(ELSE) SAME_TOKEN(SWITCH) SAME_TOKEN(CASE)
+SAME_TOKEN(DEFAULT) SAME_TOKEN(WHILE) SAME_TOKEN(DO) SAME_TOKEN(FOR)
+SAME_TOKEN(RETURN) SAME_TOKEN(BREAK) SAME_TOKEN(CONTINUE) SAME_TOKEN(GOTO)
+SAME_TOKEN(IMPORT) SAME_TOKEN(SIZEOF)
+SAME_TOKEN(IDENTIFIER) SAME_TOKEN(TYPENAME) SAME_TOKEN(INTEGER)
+SAME_TOKEN(CHARACTER) SAME_TOKEN(STRING)
+
+#undef SAME_TOKEN
+
+void parser::Recognizer::error(const location_type& loc, const std::string& msg)
+{
+    auto* option = get_option(lexer);
+    option->errors_->error(Location(option->file_, loc.begin), msg);
+}
+
+/* The tokens come from the scanner of parser.y, only identifiers keep
+ * a value. A character literal is checked here, the parser does that
+ * in its action.
+ */
+int yylex(parser::Recognizer::semantic_type *yylval,
+        parser::Recognizer::location_type *loc, yyscan_t lexer)
+{
+    parser::Parser::semantic_type value;
+    int kind = yylex(&value, loc, lexer);
+    if (kind == 0) {
+        return kind;
+    }
+    Token& tok = value.as<Token>();
+    if (kind == parser::Parser::token::IDENTIFIER) {
+        yylval->emplace<Symbol>(tok.symbol_);
+    } else if (kind == parser::Parser::token::CHARACTER &&
+            tok.value_.size() != 1) {
+        auto* option = get_option(lexer);
+        option->errors_->error(Location(option->file_, loc->begin),
+                               "character size must be 1");
+    }
+    value.destroy<Token>();
+    return kind;
+}
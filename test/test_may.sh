@@ -0,0 +1,148 @@
+#
+# test_may.sh
+#
+# may only parses so far; these tests check what it does with the
+# sources here. Run them with "make check" or "./run.sh test_may.sh".
+#
+
+MAY=${MAY:-$(pwd)/../may}
+
+# compiles importcache.cb with the headers it imports in tc.cache,
+# keeping their precompiled entries in tc.cache/entries
+may_import_cache() {
+    (cd tc.cache && "$MAY" --import-cache entries --dump-ast importcache.cb)
+}
+
+test_01_import_cache() {
+    rm -rf tc.cache
+    mkdir tc.cache
+    cp importcache.cb importcachea.hb importcacheb.hb tc.cache
+    may_import_cache >tc.cache.out 2>&1
+    assert_eq 0 $?
+    assert_eq 2 "$(ls tc.cache/entries | wc -l)"
+
+    # the headers come from the entries now
+    assert_equal "cat tc.cache.out" "may_import_cache 2>&1"
+
+    # broken entries are ignored and written again
+    for f in tc.cache/entries/*.pch
+    do
+        head -c 64 $f >$f.tmp && mv $f.tmp $f
+    done
+    assert_equal "cat tc.cache.out" "may_import_cache 2>&1"
+
+    # importcachea.hb doesn't parse without the typedef of its import,
+    # its own entry must not be used
+    sed -e 's/typedef int num;/typedef int number;/' \
+        importcacheb.hb >tc.cache/importcacheb.hb
+    assert_error may_import_cache
+}
+
+# the AST and the string constants of a file parsed in one go, the
+# only report --incremental has
+may_full() {
+    "$MAY" --dump-ast --mem-report "$@" | grep -v '^memory:\|^refcount:'
+}
+
+test_02_incremental() {
+    assert_status 0 "$MAY" --incremental incremental.cb
+    # every definition was taken out and put back, the last first
+    assert_equal "may_full incremental.cb" \
+        "\"$MAY\" --incremental --dump-ast --mem-report incremental.cb"
+}
+
+test_03_lazy_bodies() {
+    # the skipped bodies are parsed for the dump, each by itself
+    assert_equal "\"$MAY\" --dump-ast lazybodies.cb" \
+        "\"$MAY\" --lazy-bodies --dump-ast lazybodies.cb"
+    assert_equal "\"$MAY\" -j 2 --dump-ast lazybodies.cb incremental.cb" \
+        "\"$MAY\" -j 2 --lazy-bodies --dump-ast lazybodies.cb incremental.cb"
+}
+
+# what may prints for errors.cb, with a limit of $1 errors
+errors_expected() {
+    cat <<'EOF2' | head -$(($1 + 1))
+processing file errors.cb
+may: error: errors.cb:1,13: syntax error, unexpected ';'
+may: error: errors.cb:8,15: syntax error, unexpected ';'
+may: error: errors.cb:12,14: syntax error, unexpected INTEGER, expecting ';'
+may: error: errors.cb:17,5: syntax error, unexpected INT, expecting ';'
+may: error: errors.cb:23,18: syntax error, unexpected ';', expecting ')'
+EOF2
+    if [ $1 -lt 5 ]
+    then
+        echo "too many errors, giving up"
+    fi
+}
+
+test_04_errors() {
+    assert_error "$MAY" --dump-ast errors.cb
+    # the parser recovers at the end of each statement or definition
+    assert_equal "errors_expected 5" "\"$MAY\" --dump-ast errors.cb"
+    assert_equal "errors_expected 5" "\"$MAY\" --max-errors 0 errors.cb"
+    assert_equal "errors_expected 2" "\"$MAY\" --max-errors 2 errors.cb"
+    assert_error "$MAY" --max-errors 2 errors.cb
+}
+
+test_05_precedence() {
+    # precedence.out was dumped by the cascade of one rule per level
+    # that the precedence declarations replaced
+    assert_equal "cat precedence.out" "\"$MAY\" --dump-ast precedence.cb"
+}
+
+# may --syntax-only without its timing, which changes from run to run
+may_syntax() {
+    "$MAY" --syntax-only "$@" | grep -v '^syntax: '
+    return ${PIPESTATUS[0]}
+}
+
+test_06_syntax_only() {
+    # recognizer.y must accept and reject what parser.y does
+    for f in *.cb
+    do
+        "$MAY" $f >/dev/null 2>&1
+        assert_status $? may_syntax $f
+        assert_equal "\"$MAY\" $f" "may_syntax $f"
+    done
+    # the bodies are checked even if asked to skip them
+    assert_equal "\"$MAY\" errors.cb" "may_syntax --lazy-bodies errors.cb"
+    assert_error may_syntax --lazy-bodies errors.cb
+}
+
+test_07_layout() {
+    # layout.out has the sizes and offsets gcc gives on x86-64
+    assert_status 0 "$MAY" --check-types layout.cb
+    assert_equal "cat layout.out" "\"$MAY\" --check-types layout.cb"
+}
+
+# the cycles may --check-types reports, one per line with its types
+# sorted, as where the walk enters a cycle depends on the table
+may_cycles() {
+    "$MAY" --check-types "$@" |
+    sed -n 's/^.*recursive type definition: //p' |
+    while read -r types
+    do
+        echo "$types" | sed 's/, /\n/g' | sort | paste -sd ';'
+    done | sort
+}
+
+test_08_recursive_types() {
+    # a struct holding itself, and two holding each other
+    assert_error "$MAY" --check-types struct-semcheck2.cb
+    assert_equal "echo 'struct a'" "may_cycles struct-semcheck2.cb"
+    assert_error "$MAY" --check-types struct-semcheck3.cb
+    assert_equal "echo 'struct a;struct b'" "may_cycles struct-semcheck3.cb"
+    # every cycle is reported, not only the first one
+    assert_error "$MAY" --check-types struct-semcheck11.cb
+    assert_equal "printf 'struct a;struct b\nstruct d;struct d[2];struct e\n'" \
+        "may_cycles struct-semcheck11.cb"
+    # through pointers only, no cycle
+    assert_status 0 "$MAY" --check-types struct-semcheck.cb
+}
+
+test_09_duplicated_members() {
+    assert_error "$MAY" --check-types struct-semcheck7.cb
+    assert_eq 1 "$("$MAY" --check-types struct-semcheck7.cb |
+        grep -c 'struct-semcheck7.cb:1,1: duplicated member: x$')"
+    assert_error "$MAY" --check-types union-semcheck7.cb
+}
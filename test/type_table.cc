@@ -0,0 +1,75 @@
+// type_table.cc
+//
+// Checks on the types of a TypeTable that no source file reaches yet.
+// Prints the checks that fail and exits with 1 if there are any.
+
+#include <cstdio>
+
+#include "node.h"
+#include "type_table.h"
+
+using namespace cbc;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("type_table: failed: %s\n", what);
+        failures++;
+    }
+}
+
+// the parameters take over a reference of each type
+static FunctionType* function_type(TypeTable* table, Type* ret,
+                                   vector<Type*>&& params,
+                                   bool vararg=false)
+{
+    for (auto* t : params) {
+        t->inc_ref();
+    }
+    auto* p = new ParamTypes(Location(), move(params), vararg);
+    FunctionType* f = table->function_of(ret, p).get();
+    p->dec_ref();
+    return f;
+}
+
+int main()
+{
+    TypeTable* table = TypeTable::lp64();
+    Type* i = table->signed_int();
+    Type* l = table->signed_long();
+
+    // typedef int myint;
+    auto* real = new TypeNode(i);
+    auto* myint = new UserType(Symbol("myint"), real, Location());
+    real->dec_ref();
+
+    FunctionType* f_int = function_type(table, i, {i});
+    FunctionType* f_myint = function_type(table, i, {myint});
+    FunctionType* f_myint_ret = function_type(table, myint, {i});
+    FunctionType* f_long = function_type(table, i, {l});
+    FunctionType* f_vararg = function_type(table, i, {i}, true);
+
+    check(f_int->is_same_type(f_int), "f(int) is f(int)");
+    check(f_int != f_myint, "f(int) and f(myint) are distinct objects");
+    check(f_int->is_same_type(f_myint), "f(int) is f(myint)");
+    check(f_myint->is_same_type(f_int), "f(myint) is f(int)");
+    check(f_int->is_same_type(f_myint_ret), "f(int) is myint f(int)");
+    check(!f_int->is_same_type(f_long), "f(int) is not f(long)");
+    check(!f_int->is_same_type(f_vararg), "f(int) is not f(int, ...)");
+    check(!f_int->is_same_type(i), "f(int) is not int");
+
+    // typedef int fn(int);
+    auto* fnode = new TypeNode(f_int);
+    auto* fn = new UserType(Symbol("fn"), fnode, Location());
+    fnode->dec_ref();
+    check(f_int->is_same_type(fn), "f(int) is fn");
+    check(f_myint->is_same_type(fn), "f(myint) is fn");
+    check(fn->is_same_type(f_myint), "fn is f(myint)");
+
+    fn->dec_ref();
+    myint->dec_ref();
+    delete table;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+#include "arena.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace cbc {
+
+thread_local Arena* Arena::current_ = nullptr;
+thread_local unsigned long ref_ops = 0;
+
+static size_t align(size_t size)
+{
+    return (size + 15) & ~(size_t)15;
+}
+
+void* Object::operator new(size_t size)
+{
+    size = align(size + sizeof(ObjectHeader));
+    Arena* arena = Arena::current();
+    ObjectHeader* h;
+    if (arena) {
+        h = (ObjectHeader*)arena->allocate(size);
+        h->tag_ = ObjectHeader::kArena;
+    } else {
+        h = (ObjectHeader*)malloc(size);
+        if (!h) {
+            throw std::bad_alloc();
+        }
+        h->tag_ = ObjectHeader::kHeap;
+    }
+    h->size_ = size;
+    return h + 1;
+}
+
+void Object::operator delete(void* p)
+{
+    if (!p) {
+        return;
+    }
+    ObjectHeader* h = (ObjectHeader*)p - 1;
+    if (h->tag_ == ObjectHeader::kHeap) {
+        free(h);
+    } else {
+        // only reached if a constructor threw, ~Arena() skips it
+        h->tag_ = ObjectHeader::kDead;
+    }
+}
+
+Arena::Arena() : objects_(0), bytes_(0)
+{
+}
+
+Arena::~Arena()
+{
+    // Destructors still dec_ref() their members, which are usually
+    // arena objects destroyed earlier in this loop. Marking each
+    // object dead first turns those calls into no-ops, and as
+    // dec_ref() never deletes arena objects every one is destroyed
+    // exactly once, here.
+    for (auto& c : chunks_) {
+        size_t off = 0;
+        while (off < c.used_) {
+            ObjectHeader* h = (ObjectHeader*)(c.base_ + off);
+            off += h->size_;
+            if (h->tag_ == ObjectHeader::kArena) {
+                h->tag_ = ObjectHeader::kDead;
+                ((Object*)(h + 1))->~Object();
+            }
+        }
+    }
+    for (auto& c : chunks_) {
+        free(c.base_);
+    }
+}
+
+void* Arena::allocate(size_t size)
+{
+    if (chunks_.empty() ||
+            chunks_.back().size_ - chunks_.back().used_ < size) {
+        size_t n = size > kChunkSize ? size : kChunkSize;
+        char* base = (char*)malloc(n);
+        if (!base) {
+            throw std::bad_alloc();
+        }
+        chunks_.push_back(Chunk{base, 0, n});
+    }
+    Chunk& c = chunks_.back();
+    void* p = c.base_ + c.used_;
+    c.used_ += size;
+    objects_++;
+    bytes_ += size;
+    return p;
+}
+
+} // namespace cbc
@@ -0,0 +1,196 @@
+#include "scan.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace cbc {
+
+static const char* comment_end_scalar(const char* p, const char* end)
+{
+    for (; end - p >= 2; ++p) {
+        if (p[0] == '*' && p[1] == '/') {
+            return p;
+        }
+    }
+    return end;
+}
+
+static const char* quote_scalar(const char* p, const char* end, char quote)
+{
+    while (p < end) {
+        if (*p == quote) {
+            return p;
+        }
+        p += *p == '\\' ? 2 : 1;
+    }
+    return end;
+}
+
+#if defined(__x86_64__)
+
+// The comment loops compare the block at p with '*' and the one at
+// p + 1 with '/', so a set bit in both is a "*/" wherever it falls.
+// The quote loops stop at backslashes too and step over what they
+// escape. What is left at the end goes through the scalar loops.
+
+static const char* comment_end_sse2(const char* p, const char* end)
+{
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    while (end - p >= 17) {
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + 1));
+        unsigned mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, star), _mm_cmpeq_epi8(b, slash)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return comment_end_scalar(p, end);
+}
+
+static const char* quote_sse2(const char* p, const char* end, char quote)
+{
+    const __m128i q = _mm_set1_epi8(quote);
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(a, q), _mm_cmpeq_epi8(a, backslash)));
+        if (!mask) {
+            p += 16;
+            continue;
+        }
+        p += __builtin_ctz(mask);
+        if (*p == quote) {
+            return p;
+        }
+        p += 2;
+    }
+    return quote_scalar(p, end, quote);
+}
+
+__attribute__((target("avx2")))
+static const char* comment_end_avx2(const char* p, const char* end)
+{
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    while (end - p >= 33) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)p);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, star), _mm256_cmpeq_epi8(b, slash)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return comment_end_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* quote_avx2(const char* p, const char* end, char quote)
+{
+    const __m256i q = _mm256_set1_epi8(quote);
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    while (end - p >= 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)p);
+        unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(a, q), _mm256_cmpeq_epi8(a, backslash)));
+        if (!mask) {
+            p += 32;
+            continue;
+        }
+        p += __builtin_ctz(mask);
+        if (*p == quote) {
+            return p;
+        }
+        p += 2;
+    }
+    return quote_sse2(p, end, quote);
+}
+
+#endif
+
+struct ScanFunctions {
+    const char* (*comment_end_)(const char*, const char*);
+    const char* (*quote_)(const char*, const char*, char);
+};
+
+static ScanFunctions select_functions()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanFunctions{ comment_end_avx2, quote_avx2 };
+    }
+    return ScanFunctions{ comment_end_sse2, quote_sse2 };
+#else
+    return ScanFunctions{ comment_end_scalar, quote_scalar };
+#endif
+}
+
+static const ScanFunctions& functions()
+{
+    static const ScanFunctions f = select_functions();
+    return f;
+}
+
+const char* find_comment_end(const char* p, const char* end)
+{
+    return functions().comment_end_(p, end);
+}
+
+const char* find_quote(const char* p, const char* end, char quote)
+{
+    return functions().quote_(p, end, quote);
+}
+
+const char* find_block_end(const char* p, const char* end)
+{
+    int depth = 1;
+    while (p < end) {
+        const char* q;
+        switch (*p) {
+        case '{':
+            ++depth;
+            break;
+        case '}':
+            if (--depth == 0) {
+                return p;
+            }
+            break;
+        case '"':
+        case '\'':
+            q = find_quote(p + 1, end, *p);
+            if (q == end) {
+                return end;
+            }
+            p = q;
+            break;
+        case '/':
+            if (end - p >= 2 && p[1] == '*') {
+                q = find_comment_end(p + 2, end);
+                if (q == end) {
+                    return end;
+                }
+                p = q + 1;
+            } else if (end - p >= 2 && p[1] == '/') {
+                q = (const char*)memchr(p, '\n', end - p);
+                if (!q) {
+                    return end;
+                }
+                p = q;
+            }
+            break;
+        }
+        ++p;
+    }
+    return end;
+}
+
+} // namespace cbc
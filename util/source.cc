@@ -0,0 +1,268 @@
+#include "source.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace cbc {
+
+static int64_t to_nsec(const struct timespec& ts)
+{
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+SourceFile::SourceFile() :
+    buf_(nullptr), size_(0), mtime_(0), mapped_(false)
+{
+}
+
+int64_t SourceFile::mtime(const string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        return -1;
+    }
+    return to_nsec(st.st_mtim);
+}
+
+SourceFile::~SourceFile()
+{
+    release();
+}
+
+void SourceFile::release()
+{
+    if (mapped_) {
+        munmap(buf_, buffer_size());
+    } else {
+        free(buf_);
+    }
+    buf_ = nullptr;
+    size_ = 0;
+    mtime_ = 0;
+    mapped_ = false;
+}
+
+bool SourceFile::load(const string& path)
+{
+    release();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return false;
+    }
+    size_ = st.st_size;
+    mtime_ = to_nsec(st.st_mtim);
+
+    // Bytes past the end of file up to the page boundary read as
+    // zero, so they can serve as the terminators. The mapping is
+    // private because flex writes into the buffer while scanning.
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t tail = size_ % page;
+    if (tail != 0 && page - tail >= 2) {
+        void* p = mmap(nullptr, buffer_size(), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            buf_ = (char*)p;
+            mapped_ = true;
+            close(fd);
+            return true;
+        }
+    }
+
+    buf_ = (char*)malloc(buffer_size());
+    size_t n = 0;
+    while (n < size_) {
+        ssize_t r = read(fd, buf_ + n, size_ - n);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            int err = r < 0 ? errno : EIO;
+            close(fd);
+            release();
+            errno = err;
+            return false;
+        }
+        n += r;
+    }
+    buf_[size_] = buf_[size_ + 1] = 0;
+    close(fd);
+    return true;
+}
+
+void SourceFile::assign(const char* text, size_t size)
+{
+    release();
+    size_ = size;
+    buf_ = (char*)malloc(buffer_size());
+    memcpy(buf_, text, size_);
+    buf_[size_] = buf_[size_ + 1] = 0;
+}
+
+SourceManager& SourceManager::instance()
+{
+    // never destroyed, locations may be printed until the very end
+    static SourceManager* manager = new SourceManager;
+    return *manager;
+}
+
+uint32_t SourceManager::load(const string& path)
+{
+    Entry* e = new Entry;
+    if (!e->file_.load(path)) {
+        int err = errno;
+        delete e;
+        errno = err;
+        return 0;
+    }
+    e->name_ = path;
+    return add_entry(e);
+}
+
+uint32_t SourceManager::add(const string& name, const char* text,
+                            size_t size)
+{
+    Entry* e = new Entry;
+    e->file_.assign(text, size);
+    e->name_ = name;
+    return add_entry(e);
+}
+
+uint32_t SourceManager::add_entry(Entry* e)
+{
+    e->parent_ = 0;
+    e->base_ = 0;
+    e->lines_.push_back(0);
+    e->indexed_ = 0;
+
+    lock_guard<mutex> lock(mutex_);
+    entries_.push_back(e);
+    return entries_.size();
+}
+
+void SourceManager::update(uint32_t id, const char* text, size_t size)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (id == 0 || id > entries_.size() || !entries_[id - 1]) {
+        return;
+    }
+    Entry* e = entries_[id - 1];
+    e->file_.assign(text, size);
+    e->lines_.assign(1, 0);
+    e->indexed_ = 0;
+}
+
+uint32_t SourceManager::add_segment(uint32_t id, uint32_t base, size_t size)
+{
+    Entry* e = new Entry;
+    e->lines_.push_back(0);
+    e->indexed_ = 0;
+
+    lock_guard<mutex> lock(mutex_);
+    Entry* parent = id && id <= entries_.size() ? entries_[id - 1] : nullptr;
+    if (!parent || base + size > parent->file_.size()) {
+        delete e;
+        return 0;
+    }
+    e->file_.assign(parent->file_.buffer() + base, size);
+    e->name_ = parent->name_;
+    // a segment of a segment is one of the same file
+    e->parent_ = parent->parent_ ? parent->parent_ : id;
+    e->base_ = parent->base_ + base;
+    entries_.push_back(e);
+    return entries_.size();
+}
+
+void SourceManager::move_segment(uint32_t id, uint32_t base)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (id == 0 || id > entries_.size() || !entries_[id - 1]) {
+        return;
+    }
+    entries_[id - 1]->base_ = base;
+}
+
+SourceFile* SourceManager::file(uint32_t id)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (id == 0 || id > entries_.size() || !entries_[id - 1]) {
+        return nullptr;
+    }
+    return &entries_[id - 1]->file_;
+}
+
+void SourceManager::remove(uint32_t id)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (id == 0 || id > entries_.size()) {
+        return;
+    }
+    delete entries_[id - 1];
+    entries_[id - 1] = nullptr;
+}
+
+string SourceManager::name(uint32_t id)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (id == 0 || id > entries_.size() || !entries_[id - 1]) {
+        return "";
+    }
+    return entries_[id - 1]->name_;
+}
+
+void SourceManager::position(uint32_t id, uint32_t offset,
+                             int* line, int* column)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (id == 0 || id > entries_.size() || !entries_[id - 1]) {
+        *line = *column = 0;
+        return;
+    }
+    Entry* e = entries_[id - 1];
+    if (e->parent_) {
+        offset += e->base_;
+        e = entries_[e->parent_ - 1];
+        if (!e) {
+            *line = *column = 0;
+            return;
+        }
+    }
+    const char* buf = e->file_.buffer();
+    if (offset > e->file_.size()) {
+        offset = e->file_.size();
+    }
+
+    // Only look at the bytes before offset: the scanner may still be
+    // working on the file and keeps a NUL past the current token.
+    while (e->indexed_ < offset) {
+        const char* p = (const char*)memchr(buf + e->indexed_, '\n',
+                                            offset - e->indexed_);
+        if (!p) {
+            e->indexed_ = offset;
+            break;
+        }
+        e->indexed_ = p - buf + 1;
+        e->lines_.push_back(e->indexed_);
+    }
+
+    auto it = upper_bound(e->lines_.begin(), e->lines_.end(), offset);
+    *line = it - e->lines_.begin();
+    *column = offset - *(it - 1) + 1;
+}
+
+} // namespace cbc
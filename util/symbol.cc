@@ -0,0 +1,155 @@
+#include "symbol.h"
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace cbc {
+
+static const uint32_t kBlockBits = 10;
+static const uint32_t kBlockSize = 1 << kBlockBits;
+static const uint32_t kMaxBlocks = 4096;
+
+// FNV-1a
+static uint32_t hash_name(const char* p, size_t n)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* The texts live in blocks that are never moved, so str() can read
+ * them without locking: whoever holds an id got it from intern() or
+ * from another thread that did, after the text was written.
+ */
+class SymbolTable {
+public:
+    SymbolTable() : count_(1), slots_(1024, 0), hashes_(1024, 0) {
+        memset(blocks_, 0, sizeof(blocks_));
+        blocks_[0] = new string[kBlockSize];   // id 0 is ""
+    }
+
+    const string& at(uint32_t id) {
+        return blocks_[id >> kBlockBits][id & (kBlockSize - 1)];
+    }
+
+    uint32_t intern(const char* p, size_t n, uint32_t h) {
+        lock_guard<mutex> lock(mtx_);
+        size_t mask = slots_.size() - 1;
+        size_t i = h & mask;
+        for (; slots_[i] != 0; i = (i + 1) & mask) {
+            if (hashes_[i] == h && equal(slots_[i], p, n)) {
+                return slots_[i];
+            }
+        }
+
+        uint32_t id = count_;
+        if ((id >> kBlockBits) >= kMaxBlocks) {
+            throw string("too many identifiers");
+        }
+        if ((id & (kBlockSize - 1)) == 0) {
+            blocks_[id >> kBlockBits] = new string[kBlockSize];
+        }
+        blocks_[id >> kBlockBits][id & (kBlockSize - 1)].assign(p, n);
+        count_++;
+
+        slots_[i] = id;
+        hashes_[i] = h;
+        if (count_ * 2 > slots_.size()) {
+            grow();
+        }
+        return id;
+    }
+
+    bool equal(uint32_t id, const char* p, size_t n) {
+        const string& s = at(id);
+        return s.size() == n && memcmp(s.data(), p, n) == 0;
+    }
+
+    size_t count() {
+        lock_guard<mutex> lock(mtx_);
+        return count_;
+    }
+
+private:
+    void grow() {
+        vector<uint32_t> slots(slots_.size() * 2, 0);
+        vector<uint32_t> hashes(slots.size(), 0);
+        size_t mask = slots.size() - 1;
+        for (size_t j = 0; j < slots_.size(); ++j) {
+            if (slots_[j] == 0) {
+                continue;
+            }
+            size_t i = hashes_[j] & mask;
+            while (slots[i] != 0) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slots_[j];
+            hashes[i] = hashes_[j];
+        }
+        slots_.swap(slots);
+        hashes_.swap(hashes);
+    }
+
+private:
+    mutex mtx_;
+    uint32_t count_;
+    string* blocks_[kMaxBlocks];
+    // open addressing index of the ids, 0 is a free slot
+    vector<uint32_t> slots_;
+    vector<uint32_t> hashes_;
+};
+
+static SymbolTable& table()
+{
+    // never destroyed, symbols may be used by other static objects
+    static SymbolTable* t = new SymbolTable;
+    return *t;
+}
+
+/* Most identifiers repeat a lot, a small per-thread cache saves the
+ * lock for them.
+ */
+struct SymbolCacheEntry {
+    uint32_t hash_;
+    uint32_t id_;
+};
+
+static const size_t kCacheSize = 256;
+static thread_local SymbolCacheEntry cache[kCacheSize];
+
+uint32_t Symbol::intern(const char* p, size_t n)
+{
+    if (n == 0) {
+        return 0;
+    }
+    SymbolTable& t = table();
+    uint32_t h = hash_name(p, n);
+    SymbolCacheEntry& e = cache[h % kCacheSize];
+    if (e.id_ != 0 && e.hash_ == h && t.equal(e.id_, p, n)) {
+        return e.id_;
+    }
+    e.id_ = t.intern(p, n, h);
+    e.hash_ = h;
+    return e.id_;
+}
+
+const string& Symbol::str() const
+{
+    return table().at(id_);
+}
+
+size_t Symbol::count()
+{
+    return table().count();
+}
+
+size_t Symbol::capacity()
+{
+    return (size_t)kBlockSize * kMaxBlocks;
+}
+
+} // namespace cbc
@@ -1,17 +1,36 @@
 #include "node.h"
 #include "util.h"
+#include "source.h"
 #include "token.h"
 
 namespace cbc {
 
-Location::Location(const Token& tok) 
-    : tok_(tok) 
+int Location::lineno() const
 {
+    int line, column;
+    SourceManager::instance().position(file_, offset_, &line, &column);
+    return line;
 }
 
-Location::Location(const string& src, const Token &tok) 
-    : src_(src), tok_(tok) 
+int Location::column() const
 {
+    int line, column;
+    SourceManager::instance().position(file_, offset_, &line, &column);
+    return column;
+}
+
+string Location::source_name() const
+{
+    return SourceManager::instance().name(file_);
+}
+
+string Location::to_string() const
+{
+    int line, column;
+    SourceManager::instance().position(file_, offset_, &line, &column);
+    string src = source_name();
+    return (src.size() ? src : "(unknown)") + ":" + std::to_string(line) +
+        "," + std::to_string(column);
 }
 
 Dumper::Dumper(ostream &os) : os_(os), indent_(0) {}
@@ -46,6 +65,16 @@ void Dumper::print_member(const string& name, const string& str, bool is_resolve
     print_pair(name, str + (is_resolved ? " (resolved)" : ""));
 }
 
+void Dumper::print_member(const string& name, Symbol sym)
+{
+    print_member(name, sym.str(), false);
+}
+
+void Dumper::print_member(const string& name, Symbol sym, bool is_resolved)
+{
+    print_member(name, sym.str(), is_resolved);
+}
+
 void Dumper::print_member(const string& name, long l)
 {
     print_pair(name, to_string(l));
@@ -76,21 +105,24 @@ void Dumper::print_member(const string& name, TypeNode* n)
 }
 
 ErrorHandler::ErrorHandler(const string& progid) :
-    program_id_(progid), os_(cerr)
+    program_id_(progid), os_(cerr), nerror_(0), nwarning_(0), limit_(0)
 {
 
 }
 
 ErrorHandler::ErrorHandler(const string& progid, ostream& os) :
-    program_id_(progid), os_(os)
+    program_id_(progid), os_(os), nerror_(0), nwarning_(0), limit_(0)
 {
 
 }
 
 void ErrorHandler::error(const string& msg)
 {
-    os_ << program_id_ + ": error: " + msg;
+    os_ << program_id_ + ": error: " + msg << endl;
     ++nerror_;
+    if (limit_ > 0 && nerror_ >= limit_) {
+        throw string("too many errors, giving up");
+    }
 }
 
 void ErrorHandler::error(const Location& loc, const string& msg)
@@ -100,7 +132,7 @@ void ErrorHandler::error(const Location& loc, const string& msg)
 
 void ErrorHandler::warn(const string& msg)
 {
-    os_ << program_id_ + ": error: " + msg;
+    os_ << program_id_ + ": warning: " + msg << endl;
     ++nwarning_;
 }
 